@@ -9,8 +9,10 @@
 #ifndef HISTC_H_
 #define HISTC_H_
 #include <Eigen/dense>
+#include "counter_rng.h"
 namespace qrcode {
-	int histc(Eigen::VectorXf &C);
+	/*Draws an index from the cumulative weights C, rng supplies the uniform*/
+	int histc(Eigen::VectorXf &C, qrcode::CounterRNG &rng);
 }
 
 #endif // !HISTC_H_
@@ -2,12 +2,20 @@
 
 void qrcode::light(Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, Eigen::VectorXf & origin, std::vector<Eigen::Vector3f>& destinations, Eigen::Matrix<bool, Eigen::Dynamic, 1>& result)
 {
+	QR_TRACE_SCOPE("qrcode::light");
 	igl::embree::EmbreeIntersector ei;
 	int n = destinations.size();
 
 	result.resize(n);
 
-	ei.init(verticles.cast<float>(), facets);
+	/*Only facets a ray towards origin can reach; the answer is the same as on the whole mesh*/
+	qrcode::RayFootprint footprint;
+	qrcode::ray_footprint(destinations, std::vector<Eigen::Vector3f>(), { Eigen::Vector3f(origin) }, false, footprint);
+
+	Eigen::MatrixXi cropped;
+	Eigen::VectorXi facet_map;
+	if (qrcode::crop_mesh(verticles, facets, footprint, cropped, facet_map) == 0) cropped = facets;
+	ei.init(verticles.cast<float>(), cropped);
 
 	const auto &shoot_ray = [&ei](
 		const Eigen::Vector3f& s,
@@ -29,7 +37,27 @@ void qrcode::light(Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, Eigen:
 		else
 			result(p) = false;
 	};
-	igl::parallel_for(n, inner, 1000);
+	qrcode::parallel_for(n, inner);
 	//ei.deinit();
 	//ei.global_deinit();
 }
+
+void qrcode::light(const HeightField & field, Eigen::VectorXf & origin, std::vector<Eigen::Vector3f>& destinations, Eigen::Matrix<bool, Eigen::Dynamic, 1>& result)
+{
+	QR_TRACE_SCOPE("qrcode::light heightfield");
+	int n = destinations.size();
+	result.resize(n);
+
+	const Eigen::Vector3f d = origin;
+	const auto &inner = [&](const int p)
+	{
+		Eigen::Vector3f s = destinations[p];
+		result(p) = !field.intersect(s, (d - s).normalized());
+	};
+	qrcode::parallel_for(n, inner);
+}
+
+int qrcode::light_to_gray(float ambient, float direct)
+{
+	return static_cast<int>(19.6*pow((0.87*(24 * ambient + 456 * direct)), 0.3441) + 21.24);
+}
@@ -12,11 +12,18 @@
 #include <Eigen/dense>
 #include <igl/embree/EmbreeIntersector.h>
 #include <igl/Hit.h>
-#include <igl/parallel_for.h>
 #include "global.h"
+#include "heightfield.h"
+#include "crop_mesh.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
 
 	void light(Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, Eigen::VectorXf &origin, std::vector<Eigen::Vector3f>&destination, Eigen::Matrix<bool, Eigen::Dynamic, 1> &result);
+	/*Same test against a prepared height field, used while the QR grid is being carved*/
+	void light(const HeightField &field, Eigen::VectorXf &origin, std::vector<Eigen::Vector3f>&destination, Eigen::Matrix<bool, Eigen::Dynamic, 1> &result);
+	/*Simulated gray value of a cell from its ambient and direct light terms*/
+	int light_to_gray(float ambient, float direct);
 }
 #endif // !LIGHT_H_
 
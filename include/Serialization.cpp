@@ -2,6 +2,12 @@
 
 void qrcode::serialize(GLOBAL & global, std::string & binary_file)
 {
+	QR_TRACE_SCOPE("qrcode::serialize");
+	/*A tiled projection has no in memory arrays, the file could not be used again*/
+	if (global.projection.is_open()) {
+		std::cout << "Serialization is not supported for a tiled projection, project the image in memory first" << std::endl;
+		return;
+	}
 	serialize(global.info, binary_file);
 
 	igl::serialize(global.model_vertices, "Vertices", binary_file);
@@ -83,6 +89,9 @@ void qrcode::serialize(GLOBAL & global, std::string & binary_file)
 
 void qrcode::deserialize(GLOBAL & global, std::string & binary_file)
 {
+	QR_TRACE_SCOPE("qrcode::deserialize");
+	/*The loaded arrays replace any tiled projection of this session*/
+	global.projection.close();
 	global.info=deserialize(binary_file);
 
 	igl::deserialize(global.model_vertices, "Vertices", binary_file);
@@ -119,6 +128,7 @@ void qrcode::deserialize(GLOBAL & global, std::string & binary_file)
 	}
 
 	igl::deserialize(global.carve_depth, "Carving depth", binary_file);
+	global.carve_direct.resize(0, 3);
 
 	igl::deserialize(global.under_control, "Under Control", binary_file);
 
@@ -7,9 +7,11 @@
 // obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef QR_SERIALIZATION_H_
 #define QR_SERIALIZATION_H_
+#include <iostream>
 #include <igl/serialize.h>
 #include <Eigen/dense>
 #include "global.h"
+#include "trace.h"
 namespace qrcode {
 	void serialize(GLOBAL &global, std::string &binary_file);
 	void deserialize(GLOBAL &global, std::string &binary_file);
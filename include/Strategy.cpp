@@ -2,6 +2,7 @@
 
 void qrcode::control_strategy(GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::control_strategy");
 	int border = global.info.border;
 	int scale = global.info.scale;
 	int size = (2 * border + global.info.pixels.size())*scale + 2 * scale + 1;
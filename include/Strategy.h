@@ -10,6 +10,7 @@
 #define STRATEGY_H_
 #include <Eigen/dense>
 #include "global.h"
+#include "trace.h"
 namespace qrcode {
 	void control_strategy(GLOBAL &global);
 }
@@ -2,6 +2,7 @@
 
 void qrcode::visualarea(Engine * engine, Eigen::MatrixXi & modules, Eigen::MatrixXi & functions, std::vector<std::vector<qrgen::PixelProperty>>& pixel_propertys)
 {
+	QR_TRACE_SCOPE("qrcode::visualarea");
 	int size = modules.rows();
 
 	Eigen::MatrixXi label;
@@ -12,17 +13,28 @@ void qrcode::visualarea(Engine * engine, Eigen::MatrixXi & modules, Eigen::Matri
 
 	pixel_propertys.resize(size);
 	for (int i = 0; i < size; i++) pixel_propertys[i].resize(size);
-	for (int y = 0; y < size - 1; y++) {
-		for (int x = 0; x < size - 1; x++) {
-			if (modules(y, x) > 0) {
-				std::vector<Eigen::Vector2d> bound;
-				qrcode::raw_to_visible_polygon(Eigen::RowVector2d(y + 0.5, x + 0.5), bounds[label(y, x) - 1], 1, size, bound);
 
-				boost::geometry::model::polygon<boost::geometry::model::d2::point_xy<double>> poly;
-				for (int i = 0; i < bound.size(); i++) 	poly.outer().emplace_back(bound[i](0), bound[i](1));
-				pixel_propertys[y][x].area = boost::geometry::area(poly);
-				
-			}
+	/*
+	Every query builds its own Epeck arrangement, but the lazy exact numbers share
+	reference counted handles and static values inside CGAL. Those are only thread
+	safe in a threaded CGAL 5 or later, every other build runs the queries in turn.
+	*/
+	const auto area = [&](const int i) {
+		int y = i / (size - 1);
+		int x = i % (size - 1);
+		if (modules(y, x) > 0) {
+			std::vector<Eigen::Vector2d> bound;
+			Eigen::RowVector2d query(y + 0.5, x + 0.5);
+			qrcode::raw_to_visible_polygon(query, bounds[label(y, x) - 1], 1, size, bound);
+
+			boost::geometry::model::polygon<boost::geometry::model::d2::point_xy<double>> poly;
+			for (int k = 0; k < bound.size(); k++) 	poly.outer().emplace_back(bound[k](0), bound[k](1));
+			pixel_propertys[y][x].area = boost::geometry::area(poly);
 		}
-	}
-}
+	};
+#if defined(CGAL_HAS_THREADS) && CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5, 0, 0)
+	qrcode::parallel_for((size - 1)*(size - 1), area);
+#else
+	for (int i = 0; i < (size - 1)*(size - 1); i++) area(i);
+#endif
+}
\ No newline at end of file
@@ -18,6 +18,8 @@
 #include "PixelProperty.h"
 #include "bwlabel.h"
 #include "raw_to_visible_polygon.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
 	void visualarea(Engine* engine, Eigen::MatrixXi &modules, Eigen::MatrixXi &functions, std::vector<std::vector<qrgen::PixelProperty>>&pixel_propertys);
 }
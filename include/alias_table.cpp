@@ -0,0 +1,81 @@
+#include "alias_table.h"
+
+qrcode::AliasTable::AliasTable() : sum(0)
+{
+}
+
+qrcode::AliasTable::AliasTable(const Eigen::VectorXd & weights) : sum(0)
+{
+	init(weights);
+}
+
+bool qrcode::AliasTable::init(const Eigen::VectorXd & weights)
+{
+	const int n = weights.size();
+	prob.clear();
+	alias.clear();
+
+	sum = 0;
+	for (int i = 0; i < n; i++) sum += weights(i) > 0 ? weights(i) : 0;
+	if (!(sum > 0)) {
+		sum = 0;
+		return false;
+	}
+
+	/*Vose: pair every under-full column with an over-full one*/
+	std::vector<double> scaled(n);
+	std::vector<int> small, large;
+	for (int i = 0; i < n; i++) {
+		scaled[i] = (weights(i) > 0 ? weights(i) : 0)*n / sum;
+		(scaled[i] < 1 ? small : large).push_back(i);
+	}
+
+	prob.assign(n, 1.f);
+	alias.resize(n);
+	for (int i = 0; i < n; i++) alias[i] = i;
+
+	while (!small.empty() && !large.empty()) {
+		int s = small.back();
+		int l = large.back();
+		small.pop_back();
+
+		prob[s] = static_cast<float>(scaled[s]);
+		alias[s] = l;
+
+		scaled[l] += scaled[s] - 1;
+		if (scaled[l] < 1) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	/*Leftovers are full up to rounding*/
+	return true;
+}
+
+int qrcode::AliasTable::size() const
+{
+	return prob.size();
+}
+
+double qrcode::AliasTable::total() const
+{
+	return sum;
+}
+
+int qrcode::AliasTable::draw(std::uint64_t bits) const
+{
+	const std::uint64_t n = prob.size();
+	int column = static_cast<int>(((bits >> 32)*n) >> 32);
+	float side = static_cast<float>(bits & 0xffffffffULL)*(1.f / 4294967296.f);
+	return side < prob[column] ? column : alias[column];
+}
+
+int qrcode::AliasTable::draw(qrcode::CounterRNG & rng) const
+{
+	return draw(rng.next());
+}
+
+void qrcode::AliasTable::draw(qrcode::CounterRNG & rng, Eigen::VectorXi & out) const
+{
+	for (int k = 0; k < out.size(); k++) out(k) = draw(rng.next());
+}
@@ -0,0 +1,46 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef ALIAS_TABLE_H_
+#define ALIAS_TABLE_H_
+#include <vector>
+#include <cstdint>
+#include <Eigen/dense>
+#include "counter_rng.h"
+namespace qrcode {
+
+	/*
+	Walker/Vose alias table over non-negative weights. Built once, then every draw
+	is one table lookup; all draw methods are const, so threads can share a table
+	as long as each one brings its own generator.
+	*/
+	class AliasTable
+	{
+	public:
+		AliasTable();
+		explicit AliasTable(const Eigen::VectorXd &weights);
+		/*Returns false and stays empty when no weight is positive*/
+		bool init(const Eigen::VectorXd &weights);
+
+		int size() const;
+		double total() const;
+
+		/*64 random bits -> index, the high half picks the column and the low half the side*/
+		int draw(std::uint64_t bits) const;
+		int draw(qrcode::CounterRNG &rng) const;
+		/*Fills every entry of out, which keeps its size*/
+		void draw(qrcode::CounterRNG &rng, Eigen::VectorXi &out) const;
+
+	private:
+		std::vector<float> prob;
+		std::vector<int> alias;
+		double sum;
+	};
+}
+
+#endif // !ALIAS_TABLE_H_
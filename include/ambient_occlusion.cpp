@@ -1,11 +1,74 @@
 #include "ambient_occlusion.h"
 
-void qrcode::ambient_occlusion(Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, int samples, Eigen::VectorXf & result)
+void qrcode::ambient_occlusion(Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, int samples, std::uint64_t seed, Eigen::VectorXf & result)
 {
 	igl::embree::EmbreeIntersector ei;
 
 	ei.init(verticles.cast<float>(), facets);
 
+	qrcode::ambient_occlusion(ei, position, normal, samples, seed, result);
+}
+
+void qrcode::ambient_occlusion(Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf & result)
+{
+	igl::embree::EmbreeIntersector ei;
+
+	ei.init(verticles.cast<float>(), facets);
+
+	qrcode::ambient_occlusion(ei, position, normal, samples, mode, seed, result);
+}
+
+void qrcode::ambient_occlusion(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, int samples, std::uint64_t seed, Eigen::VectorXf & result)
+{
+	qrcode::ambient_occlusion(ei, position, normal, samples, AOSampling::Stratified, seed, result);
+}
+
+namespace {
+	float radical_inverse(int i, int base)
+	{
+		float inv = 1.f / base, f = inv, r = 0.f;
+		for (; i > 0; i /= base, f *= inv) r += f*(i%base);
+		return r;
+	}
+}
+
+qrcode::CosineSampler::CosineSampler(const Eigen::Vector3f & normal, std::uint64_t stream, std::uint64_t seed, RNGDomain domain) : n(normal.normalized())
+{
+	Eigen::Vector3f helper = std::abs(n(0)) < 0.9f ? Eigen::Vector3f(1.f, 0.f, 0.f) : Eigen::Vector3f(0.f, 1.f, 0.f);
+	t = n.cross(helper).normalized();
+	b = n.cross(t);
+
+	qrcode::CounterRNG rng(seed, stream, domain);
+	o1 = rng.uniform();
+	o2 = rng.uniform();
+}
+
+Eigen::Vector3f qrcode::CosineSampler::direction(int s) const
+{
+	float u1 = radical_inverse(s + 1, 2) + o1;
+	float u2 = radical_inverse(s + 1, 3) + o2;
+	if (u1 >= 1.f) u1 -= 1.f;
+	if (u2 >= 1.f) u2 -= 1.f;
+
+	/*Malley: uniform on the disk, lifted onto the hemisphere*/
+	float r = std::sqrt(u1);
+	float phi = 2 * igl::PI*u2;
+	return r*std::cos(phi)*t + r*std::sin(phi)*b + std::sqrt(std::max(0.f, 1 - u1))*n;
+}
+
+qrcode::AOProgressive::AOProgressive() : batch(16), min_samples(32), max_samples(512), tolerance(0.05f), z(1.96f)
+{
+}
+
+void qrcode::ambient_occlusion(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf & result)
+{
+	qrcode::ambient_occlusion(ei, position, normal, std::vector<int>(), samples, mode, seed, result);
+}
+
+void qrcode::ambient_occlusion(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, const std::vector<int>& streams,
+	int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf & result)
+{
+	QR_TRACE_SCOPE("qrcode::ambient_occlusion");
 	const auto & shoot_ray = [&ei](
 		const Eigen::Vector3f& s,
 		const Eigen::Vector3f& dir)->bool
@@ -18,7 +81,39 @@ void qrcode::ambient_occlusion(Eigen::MatrixXd & verticles, Eigen::MatrixXi & fa
 	const int n = position.size();
 	result.resize(n);
 
-	Eigen::MatrixXf D = igl::random_dir_stratified(samples).cast<float>();
+	if (mode == AOSampling::Progressive) {
+		AOProgressive config;
+		config.max_samples = samples;
+		config.min_samples = std::min(config.min_samples, samples);
+
+		Eigen::VectorXi rays;
+		qrcode::ambient_occlusion(ei, position, normal, streams, config, seed, result, rays);
+
+		if (n > 0)
+			std::cout << "AO rays per point: " << rays.cast<float>().mean() << " (max " << rays.maxCoeff() << ")" << std::endl;
+		return;
+	}
+
+	if (mode == AOSampling::CosineHalton) {
+		/*pdf = cos/pi, so the cosine weight cancels and AO is the unoccluded fraction*/
+		const auto & cosine = [&position, &normal, &streams, &samples, &result, &shoot_ray, &seed](const int p)
+		{
+			const Eigen::Vector3f origin = position[p];
+			const CosineSampler sampler(normal[p], streams.empty() ? p : streams[p], seed);
+
+			int open = 0;
+			for (int s = 0; s < samples; s++)
+				if (!shoot_ray(origin, sampler.direction(s))) open++;
+
+			result(p) = samples > 0 ? static_cast<float>(open) / samples : 1.f;
+		};
+		qrcode::parallel_for(n, cosine);
+		return;
+	}
+
+	Eigen::MatrixXf D;
+	qrcode::CounterRNG rng(seed, 0, qrcode::RNGDomain::AODirections);
+	qrcode::stratified_directions(rng, samples, D);
 	const auto & inner = [&position,&normal,&samples,&D,&result,&shoot_ray](const int p)
 	{
 		const Eigen::Vector3f origin = position[p];
@@ -44,15 +139,98 @@ void qrcode::ambient_occlusion(Eigen::MatrixXd & verticles, Eigen::MatrixXi & fa
 		}
 		result(p) = b / a;
 	};
-	//igl::parallel_for(n, inner, 1000);
+	qrcode::parallel_for(n, inner);
+}
+
+void qrcode::ambient_occlusion(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, const AOProgressive & config,
+	std::uint64_t seed, Eigen::VectorXf & result, Eigen::VectorXi & rays)
+{
+	qrcode::ambient_occlusion(ei, position, normal, std::vector<int>(), config, seed, result, rays);
+}
+
+void qrcode::ambient_occlusion(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal, const std::vector<int>& streams,
+	const AOProgressive & config, std::uint64_t seed, Eigen::VectorXf & result, Eigen::VectorXi & rays)
+{
+	QR_TRACE_SCOPE("qrcode::ambient_occlusion progressive");
 
+	const int n = position.size();
+	result.resize(n);
+	rays.resize(n);
+
+	const float z2 = config.z*config.z;
+
+	const auto & inner = [&](const int p)
+	{
+		const Eigen::Vector3f origin = position[p];
+		const CosineSampler sampler(normal[p], streams.empty() ? p : streams[p], seed);
+		const float tnear = 1e-3f;
+
+		int open = 0, traced = 0;
+		while (traced < config.max_samples) {
+			int end = std::min(traced + std::max(1, config.batch), config.max_samples);
+			for (; traced < end; traced++) {
+				igl::Hit hit;
+				if (!ei.intersectRay(origin, sampler.direction(traced), hit, tnear)) open++;
+			}
+			if (traced < config.min_samples) continue;
+
+			/*Wilson score interval of the open fraction*/
+			float m = static_cast<float>(traced);
+			float f = open / m;
+			float half = config.z / (1 + z2 / m)*std::sqrt(f*(1 - f) / m + z2 / (4 * m*m));
+			if (half <= config.tolerance) break;
+		}
 
-	//ei.global_deinit();
+		result(p) = traced > 0 ? static_cast<float>(open) / traced : 1.f;
+		rays(p) = traced;
+	};
+	qrcode::parallel_for(n, inner);
+}
+
+void qrcode::ao_error_report(const igl::embree::EmbreeIntersector & ei, std::vector<Eigen::Vector3f>& position, std::vector<Eigen::Vector3f>& normal,
+	const std::vector<int>& samples, int reference, std::uint64_t seed, Eigen::MatrixXf & rmse)
+{
+	QR_TRACE_SCOPE("qrcode::ao_error_report");
+
+	/*Evenly spread subset of the points*/
+	const int stride = std::max<int>(1, (position.size() + 255) / 256);
+	std::vector<Eigen::Vector3f> p, nrm;
+	for (int i = 0; i < position.size(); i += stride) {
+		p.push_back(position[i]);
+		nrm.push_back(normal[i]);
+	}
+
+	Eigen::VectorXf truth;
+	qrcode::ambient_occlusion(ei, p, nrm, reference, AOSampling::CosineHalton, seed, truth);
+
+	rmse.resize(samples.size(), 2);
+	std::cout << std::setw(10) << "AO rays" << std::setw(16) << "stratified rmse" << std::setw(16) << "cosine rmse" << std::endl;
+
+	for (int k = 0; k < samples.size(); k++) {
+		Eigen::VectorXf stratified, cosine;
+		qrcode::ambient_occlusion(ei, p, nrm, samples[k], AOSampling::Stratified, seed, stratified);
+		qrcode::ambient_occlusion(ei, p, nrm, samples[k], AOSampling::CosineHalton, seed, cosine);
+
+		rmse(k, 0) = std::sqrt((stratified - truth).squaredNorm() / std::max<int>(1, p.size()));
+		rmse(k, 1) = std::sqrt((cosine - truth).squaredNorm() / std::max<int>(1, p.size()));
+
+		std::cout << std::setw(10) << samples[k] << std::setw(16) << rmse(k, 0) << std::setw(16) << rmse(k, 1) << std::endl;
+	}
+
+	AOProgressive config;
+	Eigen::VectorXf progressive;
+	Eigen::VectorXi rays;
+	qrcode::ambient_occlusion(ei, p, nrm, config, seed, progressive, rays);
+
+	if (!p.empty())
+		std::cout << "progressive (tolerance " << config.tolerance << "): rmse " << std::sqrt((progressive - truth).squaredNorm() / p.size())
+			<< " with " << rays.cast<float>().mean() << " rays per point" << std::endl;
 }
 
 void qrcode::ambient_occlusion( Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal,
-	std::vector<qrcode::SMesh>& patch, Eigen::VectorXf & result)
+	std::vector<qrcode::SMesh>& patch, std::uint64_t seed, Eigen::VectorXf & result)
 {
+	QR_TRACE_SCOPE("qrcode::ambient_occlusion spherical");
 	static float FLT_LARGE = 1.844E18f;
 	igl::embree::EmbreeIntersector ei;
 
@@ -75,64 +253,27 @@ void qrcode::ambient_occlusion( Eigen::MatrixXd & verticles, Eigen::MatrixXi & f
 	Eigen::VectorXf area(n);
 	Eigen::VectorXf ratio(n);
 
-	Eigen::Vector3f axis = Eigen::Vector3f(0.f, 0.f, 1.f);
-	
-	const auto rander = [&position, &normal, &patch, &points, &axis, &area, &ratio](const int p) {
-		//std::cout << p << std::endl;
-		
+	/*Solid angle of the visible patch and the samples drawn on it*/
+	const auto rander = [&position, &patch, &points, &area, &ratio, &seed](const int p) {
 		const Eigen::Vector3f origin = position[p];
 
-		const Eigen::MatrixXd v = patch[p].V;
-		const Eigen::MatrixXi f = patch[p].F;
-		//std::cout << v << std::endl;
-		//std::cout << f << std::endl;
+		const Eigen::MatrixXd &v = patch[p].V;
+		const Eigen::MatrixXi &f = patch[p].F;
 
-		const Eigen::Vector3f direct = normal[p];
-		const Eigen::MatrixXf rot = qrcode::rot(direct, axis);
-
-		//Eigen::MatrixXf box(2, 2);
-
-		//area(p) = qrcode::Box(origin, v, rot, box);
-
-		Eigen::MatrixXf _V = (v.cast<float>() - origin.transpose().replicate(v.rows(), 1)).rowwise().normalized();
-		Eigen::MatrixXf Angle(f.rows(), 3);
-		Eigen::Vector3f A, B, C;
-
-		float sum = 0;
-		for (int i = 0; i < f.rows(); i++) {
-			A = _V.row(f(i, 0)).transpose();
-			B = _V.row(f(i, 1)).transpose();
-			C = _V.row(f(i, 2)).transpose();
-			//std::cout << (C.cross(A)).dot(B.cross(A)) / ((C.cross(A)).norm()*(B.cross(A)).norm()) << " ";
-			Angle(i, 0) = acos(refine((C.cross(A)).dot(B.cross(A)) / ((C.cross(A)).norm()*(B.cross(A)).norm())));
-			//std::cout << (A.cross(B)).dot(C.cross(B)) / ((A.cross(B)).norm()*(C.cross(B)).norm()) << " ";
-			Angle(i, 1) = acos(refine((A.cross(B)).dot(C.cross(B)) / ((A.cross(B)).norm()*(C.cross(B)).norm())));
-			//std::cout << (B.cross(C)).dot(A.cross(C)) / ((B.cross(C)).norm()*(A.cross(C)).norm()) << std::endl;
-			Angle(i, 2) = acos(refine((B.cross(C)).dot(A.cross(C)) / ((B.cross(C)).norm()*(A.cross(C)).norm())));
-			float temp = Angle(i, 0) + Angle(i, 1) + Angle(i, 2) - igl::PI;
-			if (temp < 0.0f)
-				sum += 0;
-			else if (temp > igl::PI) 
-				sum += igl::PI;
-			else 
-				sum += temp;
-
-		}
-		std::cout<<std::endl;
+		Eigen::VectorXf omega;
+		qrcode::solid_angle(origin, v, f, omega);
 
-		area(p) = Angle.sum() - f.rows()*igl::PI;
+		area(p) = omega.sum();
+		if (std::isnan(area(p))) area(p) = 0;
 		if (area(p) > 6.28315f) area(p) = 6.28315f;
 		if (area(p) < 2 * igl::PI*1e-5f) area(p) = 2 * igl::PI*1e-5f;
-		if (area(p) == FP_NAN) area(p) = 6.28315f*static_cast<float>(rand()) / static_cast<float>(RAND_MAX);  
-		std::cout << area(p) << std::endl;
 
 		const int sample = std::round(5* log10(area(p) / 2 / igl::PI / 1e-5));
 		ratio(p) = static_cast<float>(igl::PI / area(p)*sample*sample);
-		qrcode::random_points_on_spherical_mesh(origin, v, f, sample*sample, points[p]);
+		qrcode::random_points_on_spherical_mesh(origin, v, f, sample*sample, seed, p, points[p]);
 	};
 
-	//igl::parallel_for(n, rander, 1000);
-	for (int i = 0; i < n; i++) rander(i);
+	qrcode::parallel_for(n, rander, 1);
 	result.resize(n);
 	const auto & inner = [&position, &normal, &points, &result, &ratio, &area, &shoot_ray](const int p)
 	{
@@ -156,15 +297,12 @@ void qrcode::ambient_occlusion( Eigen::MatrixXd & verticles, Eigen::MatrixXi & f
 
 	};
 
-	igl::parallel_for(n, inner, 1000);
+	qrcode::parallel_for(n, inner);
 }
 //to solve the accuracy of acos
 float qrcode::refine(float r)
 {
-	if (abs(r) - 1.0f > 0) {
-		if (r > 0.0f)
-			return 0.999999f;
-		else
-			return -0.999999f;
-	}
+	if (r > 0.999999f) return 0.999999f;
+	if (r < -0.999999f) return -0.999999f;
+	return r;
 }
@@ -5,23 +5,92 @@
 // This Source Code Form is subject to the terms of the Mozilla Public License 
 // v. 2.0. If a copy of the MPL was not distributed with this file, You can 
 // obtain one at http://mozilla.org/MPL/2.0/.
-#ifndef AMBIRNT_OCCLUSION_H_
+#ifndef AMBIENT_OCCLUSION_H_
 #define AMBIENT_OCCLUSION_H_
 #include <vector>
+#include <algorithm>
+#include <cstdint>
 #include <Eigen/dense>
 #include <igl/embree/EmbreeIntersector.h>
-#include <igl/parallel_for.h>
-#include <igl/random_dir.h>
 #include "sphere_mesh.h"
 #include "spherical_coordinate.h"
 #include "random_points_on_spherical_mesh.h"
+#include "solid_angle.h"
+#include "counter_rng.h"
 #include <igl/serialize.h>
 #include<math.h>
+#include<cmath>
+#include<iostream>
+#include<iomanip>
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
 
-	void ambient_occlusion(Eigen::MatrixXd &vecticles, Eigen::MatrixXi &facets,std::vector<Eigen::Vector3f> &position,std::vector<Eigen::Vector3f> &normal, int samples, Eigen::VectorXf &result);
-	void ambient_occlusion(Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, std::vector<qrcode::SMesh>&patch, Eigen::VectorXf &result);
+	enum class AOSampling
+	{
+		Stratified,//qrcode::stratified_directions mirrored into the hemisphere, cosine weighted
+		CosineHalton,//Halton (2,3) mapped to cosine weighted directions, rotated per point
+		Progressive//CosineHalton in batches until the interval is tight, samples is the cap
+	};
+
+	/*Cosine weighted Halton directions around one normal, with a Cranley-Patterson rotation per stream*/
+	struct CosineSampler
+	{
+		CosineSampler(const Eigen::Vector3f &normal, std::uint64_t stream, std::uint64_t seed, RNGDomain domain = RNGDomain::AORotation);
+		Eigen::Vector3f direction(int s) const;
+
+		Eigen::Vector3f t, b, n;
+		float o1, o2;
+	};
+
+	struct AOProgressive
+	{
+		AOProgressive();
+
+		int batch;//rays traced between two checks
+		int min_samples, max_samples;
+		float tolerance;//stop once the Wilson half width is below this
+		float z;//normal quantile of the interval, 1.96 for 95%
+	};
+
+	void ambient_occlusion(Eigen::MatrixXd &vecticles, Eigen::MatrixXi &facets,std::vector<Eigen::Vector3f> &position,std::vector<Eigen::Vector3f> &normal, int samples, std::uint64_t seed, Eigen::VectorXf &result);
+	void ambient_occlusion(Eigen::MatrixXd &vecticles, Eigen::MatrixXi &facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf &result);
+	/*Same as above with a prepared intersector, so several passes can share one BVH*/
+	void ambient_occlusion(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, int samples, std::uint64_t seed, Eigen::VectorXf &result);
+	void ambient_occlusion(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf &result);
+	/*streams[p] keys the random stream of point p (e.g. its cell), so a point draws the same samples whatever else is traced with it; empty uses p*/
+	void ambient_occlusion(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, const std::vector<int> &streams,
+		int samples, AOSampling mode, std::uint64_t seed, Eigen::VectorXf &result);
+
+	//************************************
+	// Method:    qrcode::ambient_occlusion
+	//
+	// Progressive cosine weighted AO. Each point traces its Halton sequence in batches
+	// and stops when the Wilson score interval of its open fraction is narrower than
+	// config.tolerance, so open cells stop early and cells in carved pits keep going.
+	// The sequence is low discrepancy rather than independent, which only makes the
+	// interval conservative.
+	//
+	// @param std::uint64_t seed  job seed (GLOBAL::seed), every random stream is keyed by it
+	// @param Eigen::VectorXi & rays  rays traced for every point
+	//************************************
+	void ambient_occlusion(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, const AOProgressive &config,
+		std::uint64_t seed, Eigen::VectorXf &result, Eigen::VectorXi &rays);
+	void ambient_occlusion(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, const std::vector<int> &streams,
+		const AOProgressive &config, std::uint64_t seed, Eigen::VectorXf &result, Eigen::VectorXi &rays);
+
+	//************************************
+	// Method:    qrcode::ao_error_report
+	//
+	// RMS error of both sampling modes against a CosineHalton reference of `reference`
+	// rays, for every count in samples, on at most 256 evenly spread points. Prints a
+	// table and returns it as samples.size() x 2 (Stratified, CosineHalton); the error
+	// and mean rays of the default progressive estimator are printed below it.
+	//************************************
+	void ao_error_report(const igl::embree::EmbreeIntersector &ei, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal,
+		const std::vector<int> &samples, int reference, std::uint64_t seed, Eigen::MatrixXf &rmse);
+	void ambient_occlusion(Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, std::vector<Eigen::Vector3f> &position, std::vector<Eigen::Vector3f> &normal, std::vector<qrcode::SMesh>&patch, std::uint64_t seed, Eigen::VectorXf &result);
 	float refine(float r);
 }
-#endif // !AMBIRNT_OCCLUSION_H_
+#endif // !AMBIENT_OCCLUSION_H_
 
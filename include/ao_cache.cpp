@@ -0,0 +1,124 @@
+#include "ao_cache.h"
+#include "global.h"
+
+namespace {
+	std::uint64_t combine(std::uint64_t h, std::uint64_t v)
+	{
+		h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+		h *= 0xff51afd7ed558ccdULL;
+		return h ^ (h >> 33);
+	}
+
+	std::uint64_t bits(float f)
+	{
+		std::uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+}
+
+qrcode::AOCache::AOCache() : radius(-1), hits(0), misses(0), version(0)
+{
+}
+
+void qrcode::AOCache::begin_mesh()
+{
+	clear();
+	version++;
+}
+
+void qrcode::AOCache::clear()
+{
+	entries.clear();
+	depth_seen.resize(0);
+	hits = misses = 0;
+}
+
+void qrcode::AOCache::sync(GLOBAL & global)
+{
+	const Eigen::VectorXd &depth = global.carve_depth;
+
+	if (depth_seen.size() != depth.size()) {
+		if (depth_seen.size() != 0) entries.clear();
+		depth_seen = depth;
+		return;
+	}
+
+	const int rows = global.indicator.size();
+	const int cols = rows > 0 ? global.indicator[0].size() : 0;
+	const int r = radius < 0 ? global.info.scale : radius;
+
+	/*Cells within r of a carved vertex*/
+	Eigen::MatrixXi dirty;
+	dirty.setZero(rows, cols);
+	bool any = false;
+
+	for (int i = 0; i < depth.size(); i++) {
+		if (depth(i) == depth_seen(i)) continue;
+		any = true;
+
+		int y = global.anti_indicatior[i / 4](0);
+		int x = global.anti_indicatior[i / 4](1);
+		for (int v = std::max(0, y - r); v <= std::min(rows - 1, y + r); v++)
+			for (int u = std::max(0, x - r); u <= std::min(cols - 1, x + r); u++)
+				dirty(v, u) = 1;
+	}
+	depth_seen = depth;
+	if (!any) return;
+
+	for (auto it = entries.begin(); it != entries.end();) {
+		int y = global.anti_indicatior[it->second.cell](0);
+		int x = global.anti_indicatior[it->second.cell](1);
+		if (dirty(y, x)) it = entries.erase(it);
+		else ++it;
+	}
+}
+
+void qrcode::AOCache::ambient_occlusion(GLOBAL & global, const igl::embree::EmbreeIntersector & ei, std::vector<int>& cells, std::vector<Eigen::Vector3f>& position,
+	std::vector<Eigen::Vector3f>& normal, int samples, AOSampling mode, Eigen::VectorXf & result)
+{
+	QR_TRACE_SCOPE("AOCache::ambient_occlusion");
+	sync(global);
+
+	const int n = position.size();
+	result.resize(n);
+
+	std::vector<std::uint64_t> key(n);
+	std::vector<int> miss, miss_cell;
+	std::vector<Eigen::Vector3f> miss_position, miss_normal;
+
+	for (int i = 0; i < n; i++) {
+		std::uint64_t h = combine(combine(version, static_cast<std::uint64_t>(global.seed)), cells[i]);
+		for (int k = 0; k < 3; k++) h = combine(h, bits(position[i](k)));
+		for (int k = 0; k < 3; k++) h = combine(h, bits(normal[i](k)));
+		h = combine(h, samples);
+		h = combine(h, static_cast<std::uint64_t>(mode));
+		key[i] = h;
+
+		auto found = entries.find(h);
+		if (found != entries.end()) {
+			result(i) = found->second.value;
+			hits++;
+		}
+		else {
+			miss.push_back(i);
+			miss_cell.push_back(cells[i]);
+			miss_position.push_back(position[i]);
+			miss_normal.push_back(normal[i]);
+		}
+	}
+
+	if (miss.empty()) return;
+
+	Eigen::VectorXf traced;
+	/*Streams keyed by cell, not by the position in the batch of misses*/
+	qrcode::ambient_occlusion(ei, miss_position, miss_normal, miss_cell, samples, mode, global.seed, traced);
+
+	for (int k = 0; k < miss.size(); k++) {
+		int i = miss[k];
+		result(i) = traced(k);
+		Entry e = { cells[i], traced(k) };
+		entries[key[i]] = e;
+	}
+	misses += miss.size();
+}
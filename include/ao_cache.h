@@ -0,0 +1,70 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef AO_CACHE_H_
+#define AO_CACHE_H_
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <Eigen/dense>
+#include <igl/embree/EmbreeIntersector.h>
+#include "ambient_occlusion.h"
+namespace qrcode {
+
+	struct GLOBAL;
+
+	/*
+	Memoised ambient occlusion of QR cells. An entry is keyed by a hash of (mesh
+	version, job seed, cell, point, normal, sample count, mode), so moving a point
+	or changing the sampling is a plain miss. Carving a cell does not move its neighbours, but it
+	changes what they see: every lookup first compares carve_depth with the depths of
+	the previous lookup and drops the entries of all cells within radius of a change.
+	Rays are unbounded, so the radius trades exactness for reuse.
+	*/
+	class AOCache
+	{
+	public:
+		AOCache();
+
+		/*New merged mesh: forget everything and bump the mesh version*/
+		void begin_mesh();
+		void clear();
+
+		//************************************
+		// Method:    qrcode::AOCache::ambient_occlusion
+		//
+		// Same result as qrcode::ambient_occlusion with cells as the streams; only the
+		// misses are traced, in one parallel batch, so what the cache holds never changes
+		// the samples of a cell.
+		//
+		// @param std::vector<int> & cells  anti_indicatior index of every point
+		//************************************
+		void ambient_occlusion(GLOBAL &global, const igl::embree::EmbreeIntersector &ei, std::vector<int> &cells, std::vector<Eigen::Vector3f> &position,
+			std::vector<Eigen::Vector3f> &normal, int samples, AOSampling mode, Eigen::VectorXf &result);
+
+		int radius;//invalidation radius in grid cells, <0 for one module (info.scale)
+		int hits, misses;
+
+	private:
+		void sync(GLOBAL &global);
+
+		struct Entry
+		{
+			int cell;
+			float value;
+		};
+
+		std::uint64_t version;
+		std::unordered_map<std::uint64_t, Entry> entries;
+		Eigen::VectorXd depth_seen;
+	};
+}
+
+#endif // !AO_CACHE_H_
@@ -0,0 +1,161 @@
+#include "bitgrid.h"
+
+qrcode::BitGrid::BitGrid() : r(0), c(0), words(0)
+{
+}
+
+qrcode::BitGrid::BitGrid(int rows, int cols) : r(rows), c(cols), words((cols + 63) >> 6), bits(static_cast<size_t>(rows)*((cols + 63) >> 6), 0)
+{
+}
+
+qrcode::BitGrid::BitGrid(const Eigen::MatrixXi & m) : BitGrid(m.rows(), m.cols())
+{
+	for (int y = 0; y < r; y++) {
+		std::uint64_t *w = row(y);
+		for (int x = 0; x < c; x++)
+			if (m(y, x) != 0) w[x >> 6] |= 1ULL << (x & 63);
+	}
+}
+
+void qrcode::BitGrid::set(int y, int x, bool on)
+{
+	std::uint64_t bit = 1ULL << (x & 63);
+	if (on)
+		row(y)[x >> 6] |= bit;
+	else
+		row(y)[x >> 6] &= ~bit;
+}
+
+void qrcode::BitGrid::fill(int y, int x0, int x1)
+{
+	std::uint64_t *w = row(y);
+	for (int x = x0; x < x1;) {
+		int k = x >> 6;
+		int lo = x & 63;
+		int hi = std::min(64, x1 - (k << 6));
+		std::uint64_t mask = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & (~0ULL << lo);
+		w[k] |= mask;
+		x = (k + 1) << 6;
+	}
+}
+
+int qrcode::BitGrid::count() const
+{
+	int n = 0;
+	for (int i = 0; i < bits.size(); i++) n += popcount64(bits[i]);
+	return n;
+}
+
+void qrcode::BitGrid::to_matrix(Eigen::MatrixXi & m) const
+{
+	m.setZero(r, c);
+	std::vector<Eigen::Vector3i> list;
+	runs(list);
+	for (int i = 0; i < list.size(); i++)
+		m.block(list[i](0), list[i](1), 1, list[i](2)).setOnes();
+}
+
+int qrcode::BitGrid::next_set(int y, int x) const
+{
+	if (x >= c) return c;
+	const std::uint64_t *w = row(y);
+
+	int k = x >> 6;
+	std::uint64_t word = w[k] & (~0ULL << (x & 63));
+	while (word == 0) {
+		if (++k == words) return c;
+		word = w[k];
+	}
+	return (k << 6) + ctz64(word);
+}
+
+void qrcode::BitGrid::runs(std::vector<Eigen::Vector3i>& out) const
+{
+	out.clear();
+	for (int y = 0; y < r; y++) {
+		const std::uint64_t *w = row(y);
+
+		/*Alternate between the next one and the next zero of the row*/
+		int x = next_set(y, 0);
+		while (x < c) {
+			int k = x >> 6;
+			std::uint64_t word = ~w[k] & (~0ULL << (x & 63));
+			while (word == 0 && ++k < words) word = ~w[k];
+
+			int end = word == 0 ? c : std::min(c, (k << 6) + ctz64(word));
+			out.emplace_back(y, x, end - x);
+			x = next_set(y, end);
+		}
+	}
+}
+
+qrcode::BitGrid qrcode::BitGrid::operator&(const BitGrid & other) const
+{
+	BitGrid result(*this);
+	for (int i = 0; i < bits.size(); i++) result.bits[i] &= other.bits[i];
+	return result;
+}
+
+qrcode::BitGrid qrcode::BitGrid::operator|(const BitGrid & other) const
+{
+	BitGrid result(*this);
+	for (int i = 0; i < bits.size(); i++) result.bits[i] |= other.bits[i];
+	return result;
+}
+
+qrcode::BitGrid qrcode::BitGrid::operator~() const
+{
+	BitGrid result(*this);
+	for (int i = 0; i < bits.size(); i++) result.bits[i] = ~bits[i];
+	result.clear_tail();
+	return result;
+}
+
+qrcode::BitGrid qrcode::BitGrid::shifted(int dx) const
+{
+	if (dx == 0) return *this;
+	BitGrid result(r, c);
+
+	for (int y = 0; y < r; y++) {
+		const std::uint64_t *src = row(y);
+		std::uint64_t *dst = result.row(y);
+
+		if (dx > 0) {
+			/*Towards higher columns: carry the top bits into the next word*/
+			std::uint64_t carry = 0;
+			for (int k = 0; k < words; k++) {
+				dst[k] = (src[k] << dx) | carry;
+				carry = src[k] >> (64 - dx);
+			}
+		}
+		else {
+			int s = -dx;
+			for (int k = 0; k < words; k++) {
+				std::uint64_t next = k + 1 < words ? src[k + 1] : 0;
+				dst[k] = (src[k] >> s) | (next << (64 - s));
+			}
+		}
+	}
+	result.clear_tail();
+	return result;
+}
+
+qrcode::BitGrid qrcode::BitGrid::upsample(int scale) const
+{
+	BitGrid result(r*scale, c*scale);
+	std::vector<Eigen::Vector3i> list;
+	runs(list);
+
+	/*One word fill per covered word and output row, whatever the run length*/
+	for (int i = 0; i < list.size(); i++)
+		for (int u = 0; u < scale; u++)
+			result.fill(list[i](0)*scale + u, list[i](1)*scale, (list[i](1) + list[i](2))*scale);
+	return result;
+}
+
+void qrcode::BitGrid::clear_tail()
+{
+	if ((c & 63) == 0) return;
+	std::uint64_t mask = (1ULL << (c & 63)) - 1;
+	for (int y = 0; y < r; y++) row(y)[words - 1] &= mask;
+}
@@ -0,0 +1,97 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef BITGRID_H_
+#define BITGRID_H_
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <Eigen/dense>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+namespace qrcode {
+
+	/*Bit scans on 64 bit words, v must not be 0 for ctz*/
+	inline int ctz64(std::uint64_t v)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, v);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(v);
+#endif
+	}
+
+	inline int popcount64(std::uint64_t v)
+	{
+#ifdef _MSC_VER
+		return static_cast<int>(__popcnt64(v));
+#else
+		return __builtin_popcountll(v);
+#endif
+	}
+
+	/*
+	Binary grid packed 64 modules per word, row-major, bit x%64 of word x/64 is
+	column x. Bits past cols in the last word of a row are always 0, so whole
+	words can be combined and counted without masking.
+	*/
+	class BitGrid
+	{
+	public:
+		BitGrid();
+		BitGrid(int rows, int cols);
+		/*Nonzero entries become 1*/
+		explicit BitGrid(const Eigen::MatrixXi &m);
+
+		int rows() const { return r; }
+		int cols() const { return c; }
+
+		bool get(int y, int x) const
+		{
+			return (row(y)[x >> 6] >> (x & 63)) & 1;
+		}
+		void set(int y, int x, bool on);
+		/*Sets columns [x0, x1) of row y*/
+		void fill(int y, int x0, int x1);
+
+		int count() const;
+		void to_matrix(Eigen::MatrixXi &m) const;
+
+		//************************************
+		// Method:    qrcode::BitGrid::runs
+		//
+		// Maximal horizontal runs of ones as (row, first column, length), row by row
+		// from the left; the same runs a 4-connected bwlabel yields along each row.
+		//************************************
+		void runs(std::vector<Eigen::Vector3i> &out) const;
+		/*Lowest set column of row y at or after x, cols() if none*/
+		int next_set(int y, int x) const;
+
+		BitGrid operator&(const BitGrid &other) const;
+		BitGrid operator|(const BitGrid &other) const;
+		/*Complement inside the grid*/
+		BitGrid operator~() const;
+		/*result(y, x) = this(y, x - dx), zeros shifted in; |dx| < 64*/
+		BitGrid shifted(int dx) const;
+		/*Every module becomes a scale x scale block*/
+		BitGrid upsample(int scale) const;
+
+	private:
+		const std::uint64_t *row(int y) const { return &bits[y*words]; }
+		std::uint64_t *row(int y) { return &bits[y*words]; }
+		void clear_tail();
+
+		int r, c, words;
+		std::vector<std::uint64_t> bits;
+	};
+}
+
+#endif // !BITGRID_H_
@@ -1,11 +1,18 @@
 #include "bwlabel.h"
 
+namespace {
+	std::mutex matlab_lock;
+}
+
 void qrcode::bwlabel(Engine * engine, Eigen::MatrixXi & bw, int connectivity, Eigen::MatrixXi & label)
 {
+	QR_TRACE_SCOPE("qrcode::bwlabel");
 	assert(!(connectivity != 4 && connectivity != 8) && "connectivity must be 4 or 8!!!");
 
 	Eigen::MatrixXf BW = bw.cast<float>();
 
+	/*bw and label live in the engine workspace, which every job shares*/
+	std::lock_guard<std::mutex> guard(matlab_lock);
 	igl::matlab::mlsetmatrix(&engine, "bw",BW);
 	if (connectivity == 8)
 		igl::matlab::mleval(&engine, "label=bwlabel(bw,8);");
@@ -20,6 +27,7 @@ void qrcode::bwlabel(Engine * engine, Eigen::MatrixXi & bw, int connectivity, Ei
 
 void qrcode::bwbound(Eigen::MatrixXi & label, std::vector<Eigen::MatrixXi>& bound)
 {
+	QR_TRACE_SCOPE("qrcode::bwbound");
 
 	Eigen::MatrixXi kinds,edges;
 	igl::unique(label, kinds);
@@ -9,10 +9,12 @@
 #define BWLABEL_H_
 #include <cassert>
 #include <algorithm>
+#include <mutex>
 #include <igl/matlab/matlabinterface.h>
 #include <igl/unique.h>
 #include <Eigen/dense>
 #include "halfedge.h"
+#include "trace.h"
 namespace qrcode {
 	/*label black and withe blocks using 4-connectivity or 8-connectivity*/
 	void bwlabel(Engine *engine, Eigen::MatrixXi &bw, int connectivity, Eigen::MatrixXi &label);
@@ -1,32 +1,68 @@
 #include "carving_down.h"
 
+namespace {
+	/*Stable order by row and the first position of every row, so a row keeps the order of the calls*/
+	void by_row(const std::vector<int> &row, std::vector<int> &order, std::vector<int> &start)
+	{
+		order.resize(row.size());
+		for (int i = 0; i < order.size(); i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&row](int a, int b) {return row[a] < row[b]; });
+
+		start.clear();
+		for (int i = 0; i < order.size(); i++)
+			if (i == 0 || row[order[i]] != row[order[i - 1]]) start.push_back(i);
+		start.push_back(order.size());
+	}
+}
+
 void qrcode::carving_down(GLOBAL & global, Eigen::MatrixXd & result)
 {
-	result.resize(global.qr_verticals.rows(), 3);
-	int size = (global.info.pixels.size() + 2 * global.info.border)*global.info.scale;
-	for (int i = 0; i < global.qr_verticals.rows(); i++) {
-		int index = i / 4;
-		int quot = i % 4;
-		int y = global.anti_indicatior[index](0);
-		int x = global.anti_indicatior[index](1);
-		int u = quot % 2;
-		int v = quot / 2;
-		result.row(i) = global.qr_verticals.row(i) + global.carve_depth(i)*global.direct.row((y + u)*(size+1) + x + v).cast<double>();
+	QR_TRACE_SCOPE("qrcode::carving_down");
+	const int n = global.qr_verticals.rows();
+
+	/*Projection direction of every vertex, gathered once per QR grid*/
+	if (global.carve_direct.rows() != n) {
+		int size = (global.info.pixels.size() + 2 * global.info.border)*global.info.scale;
+		global.carve_direct.resize(n, 3);
+
+		qrcode::parallel_for(n / 4, [&](const int index) {
+			int y = global.anti_indicatior[index](0);
+			int x = global.anti_indicatior[index](1);
+			for (int quot = 0; quot < 4; quot++) {
+				int u = quot % 2;
+				int v = quot / 2;
+				global.carve_direct.row(4 * index + quot) = qrcode::projected_direct(global, (y + u)*(size + 1) + x + v).cast<double>();
+			}
+		}, 4096);
 	}
+
+	/*One packed expression over the whole grid*/
+	result.resize(n, 3);
+	result = global.qr_verticals + (global.carve_direct.array().colwise()*global.carve_depth.head(n).array()).matrix();
 }
 
-void qrcode::patch(int y, int x, GLOBAL & global,Eigen::Vector4d &patch)
+void qrcode::patch(int y, int x, GLOBAL & global, const Eigen::Vector4d &patch)
 {
-	std::cout << global.carve_depth.rows() << std::endl;
 	int index = global.indicator[y][x](1);
-	std::cout << index << std::endl;
-	global.carve_depth(4 * index) = patch(0);
-	global.carve_depth(4 * index + 1) = patch(1);
-	global.carve_depth(4 * index + 2) = patch(2);
-	global.carve_depth(4 * index + 3) = patch(3);
+	global.carve_depth.segment<4>(4 * index) = patch;
 }
 
-void qrcode::patch(int y, int x, Eigen::VectorXf depth, Eigen::MatrixXi &modules,GLOBAL & global)
+void qrcode::patch(const std::vector<Eigen::Vector2i>& cells, const std::vector<Eigen::Vector4d>& patches, GLOBAL & global)
+{
+	QR_TRACE_SCOPE("qrcode::patch cells");
+	std::vector<int> row(cells.size()), order, start;
+	for (int i = 0; i < cells.size(); i++) row[i] = cells[i](0);
+	by_row(row, order, start);
+
+	qrcode::parallel_for(static_cast<int>(start.size()) - 1, [&](const int r) {
+		for (int i = start[r]; i < start[r + 1]; i++) {
+			const Eigen::Vector2i &cell = cells[order[i]];
+			qrcode::patch(cell(0), cell(1), global, patches[order[i]]);
+		}
+	}, 1);
+}
+
+void qrcode::patch(int y, int x, const Eigen::VectorXf &depth, const Eigen::MatrixXi &modules, GLOBAL & global)
 {
 	int index_t = global.indicator[y][x](1);
 	int index_t_1 = global.indicator[y][x - 1](1);
@@ -43,3 +79,18 @@ void qrcode::patch(int y, int x, Eigen::VectorXf depth, Eigen::MatrixXi &modules
 		global.carve_depth(4 * index_t + 3) = 2 * depth(index_t) - global.carve_depth(4 * index_t+1);
 	}
 }
+
+void qrcode::patch_rows(const std::vector<int>& cells, const Eigen::VectorXf & depth, const Eigen::MatrixXi & modules, GLOBAL & global)
+{
+	QR_TRACE_SCOPE("qrcode::patch_rows");
+	std::vector<int> row(cells.size()), order, start;
+	for (int i = 0; i < cells.size(); i++) row[i] = global.anti_indicatior[cells[i]](0);
+	by_row(row, order, start);
+
+	qrcode::parallel_for(static_cast<int>(start.size()) - 1, [&](const int r) {
+		for (int i = start[r]; i < start[r + 1]; i++) {
+			const Eigen::Vector2i &cell = global.anti_indicatior[cells[order[i]]];
+			qrcode::patch(cell(0), cell(1), depth, modules, global);
+		}
+	}, 1);
+}
@@ -8,12 +8,27 @@
 
 #ifndef CARVING_DOWN_H_
 #define CARVING_DOWN_H_
+#include <vector>
+#include <algorithm>
 #include <Eigen/dense>
 #include "global.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
+	/*qr_verticals moved along their projection direction by carve_depth*/
 	void carving_down(GLOBAL &global, Eigen::MatrixXd &result);
-	void patch(int y, int x, GLOBAL &global,Eigen::Vector4d &patch);
-	void patch(int y, int x,Eigen::VectorXf depth , Eigen::MatrixXi &modules, GLOBAL &global);
+	void patch(int y, int x, GLOBAL &global, const Eigen::Vector4d &patch);
+	/*Many cells at once; rows run in parallel and a cell listed twice keeps its last patch*/
+	void patch(const std::vector<Eigen::Vector2i> &cells, const std::vector<Eigen::Vector4d> &patches, GLOBAL &global);
+	void patch(int y, int x, const Eigen::VectorXf &depth, const Eigen::MatrixXi &modules, GLOBAL &global);
+	//************************************
+	// Method:    qrcode::patch_rows
+	//
+	// The depth coupled patch for every listed anti_indicatior cell. A cell only reads
+	// its left neighbour in the same row, so rows run in parallel and the cells of a
+	// row keep the order of the list, as the single cell calls would.
+	//************************************
+	void patch_rows(const std::vector<int> &cells, const Eigen::VectorXf &depth, const Eigen::MatrixXi &modules, GLOBAL &global);
 }
 
 #endif // !CARVING_DOWN_H_
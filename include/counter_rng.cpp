@@ -0,0 +1,79 @@
+#include "counter_rng.h"
+
+namespace {
+	void mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t &hi, std::uint32_t &lo)
+	{
+		std::uint64_t p = static_cast<std::uint64_t>(a)*b;
+		hi = static_cast<std::uint32_t>(p >> 32);
+		lo = static_cast<std::uint32_t>(p);
+	}
+
+	/*Philox4x32 with 10 rounds, Salmon et al. 2011*/
+	void philox(std::uint32_t c[4], std::uint32_t k0, std::uint32_t k1)
+	{
+		for (int round = 0; round < 10; round++) {
+			if (round > 0) {
+				k0 += 0x9E3779B9u;
+				k1 += 0xBB67AE85u;
+			}
+			std::uint32_t hi0, lo0, hi1, lo1;
+			mulhilo(0xD2511F53u, c[0], hi0, lo0);
+			mulhilo(0xCD9E8D57u, c[2], hi1, lo1);
+
+			std::uint32_t x0 = hi1 ^ c[1] ^ k0;
+			std::uint32_t x2 = hi0 ^ c[3] ^ k1;
+			c[0] = x0;
+			c[1] = lo1;
+			c[2] = x2;
+			c[3] = lo0;
+		}
+	}
+}
+
+qrcode::CounterRNG::CounterRNG(std::uint64_t seed, std::uint64_t stream, RNGDomain domain) : counter(0)
+{
+	key[0] = static_cast<std::uint32_t>(seed);
+	key[1] = static_cast<std::uint32_t>(seed >> 32) ^ (static_cast<std::uint32_t>(domain) * 0x9E3779B9u);
+	this->stream[0] = static_cast<std::uint32_t>(stream);
+	this->stream[1] = static_cast<std::uint32_t>(stream >> 32);
+}
+
+std::uint64_t qrcode::CounterRNG::at(std::uint64_t counter) const
+{
+	std::uint32_t c[4] = { static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32), stream[0], stream[1] };
+	philox(c, key[0], key[1]);
+	return (static_cast<std::uint64_t>(c[0]) << 32) | c[1];
+}
+
+std::uint64_t qrcode::CounterRNG::next()
+{
+	return at(counter++);
+}
+
+float qrcode::CounterRNG::uniform()
+{
+	return static_cast<float>(next() >> 40)*(1.f / 16777216.f);
+}
+
+void qrcode::stratified_directions(CounterRNG & rng, int n, Eigen::MatrixXf & D)
+{
+	const float pi = 3.14159265358979f;
+	const int m = static_cast<int>(std::floor(std::sqrt(static_cast<float>(std::max(n, 0)))));
+	D.resize(std::max(n, 0), 3);
+
+	const auto direction = [&D, pi](int row, float u, float v) {
+		float z = 1 - 2 * u;
+		float r = std::sqrt(std::max(0.f, 1 - z*z));
+		float phi = 2 * pi*v;
+		D.row(row) << r*std::cos(phi), r*std::sin(phi), z;
+	};
+
+	for (int i = 0; i < m; i++)
+		for (int j = 0; j < m; j++) {
+			float u = (i + rng.uniform()) / m;
+			float v = (j + rng.uniform()) / m;
+			direction(i*m + j, u, v);
+		}
+
+	for (int k = m*m; k < n; k++) direction(k, rng.uniform(), rng.uniform());
+}
@@ -0,0 +1,57 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef COUNTER_RNG_H_
+#define COUNTER_RNG_H_
+#include <cstdint>
+#include <cmath>
+#include <Eigen/dense>
+namespace qrcode {
+
+	/*Keeps streams of the same point apart when it is sampled for different purposes*/
+	enum class RNGDomain : std::uint32_t
+	{
+		Default,
+		AORotation,//per point rotation of the cosine Halton set
+		AODirections,//stratified AO directions
+		SphereSamples,//points on the visible spherical mesh
+		Render
+	};
+
+	/*
+	Counter based generator (Philox4x32-10): draw k of a stream is a pure function of
+	(seed, domain, stream, k), so every point owns a stream without shared state and a
+	result is bit identical whatever the thread count or the order of the work.
+	*/
+	class CounterRNG
+	{
+	public:
+		CounterRNG(std::uint64_t seed, std::uint64_t stream, RNGDomain domain = RNGDomain::Default);
+
+		/*Draw at an arbitrary position of the stream, does not advance it*/
+		std::uint64_t at(std::uint64_t counter) const;
+		std::uint64_t next();
+		/*Uniform in [0,1)*/
+		float uniform();
+
+	private:
+		std::uint32_t key[2];
+		std::uint32_t stream[2];
+		std::uint64_t counter;
+	};
+
+	//************************************
+	// Method:    qrcode::stratified_directions
+	//
+	// Seeded replacement of igl::random_dir_stratified: floor(sqrt(n))^2 jittered
+	// cells of (cos theta, phi) mapped onto the sphere, the remainder drawn uniformly.
+	//************************************
+	void stratified_directions(CounterRNG &rng, int n, Eigen::MatrixXf &D);
+}
+
+#endif // !COUNTER_RNG_H_
@@ -0,0 +1,175 @@
+#include "crop_mesh.h"
+
+namespace {
+	int gather(const Eigen::MatrixXi &facets, const std::vector<char> &keep, Eigen::MatrixXi &cropped, Eigen::VectorXi &facet_map)
+	{
+		int count = 0;
+		for (int f = 0; f < keep.size(); f++) count += keep[f];
+
+		cropped.resize(count, 3);
+		facet_map.resize(count);
+		for (int f = 0, i = 0; f < keep.size(); f++) {
+			if (!keep[f]) continue;
+			cropped.row(i) = facets.row(f);
+			facet_map(i++) = f;
+		}
+		return count;
+	}
+}
+
+void qrcode::ray_footprint(const std::vector<Eigen::Vector3f>& position, const std::vector<Eigen::Vector3f>& normal, const std::vector<Eigen::Vector3f>& sources,
+	bool ambient, RayFootprint & footprint)
+{
+	footprint.box.setEmpty();
+	for (int i = 0; i < position.size(); i++) footprint.box.extend(position[i].cast<double>());
+
+	footprint.sources.clear();
+	for (int i = 0; i < sources.size(); i++) footprint.sources.push_back(sources[i].cast<double>());
+
+	footprint.ambient = ambient;
+	footprint.axis.setZero();
+	footprint.spread = 0;
+
+	if (!ambient) return;
+
+	for (int i = 0; i < normal.size(); i++) footprint.axis += normal[i].cast<double>().normalized();
+	if (footprint.axis.norm() < 1e-9) {
+		footprint.spread = igl::PI;
+		return;
+	}
+	footprint.axis.normalize();
+
+	for (int i = 0; i < normal.size(); i++) {
+		double c = std::max(-1.0, std::min(1.0, footprint.axis.dot(normal[i].cast<double>().normalized())));
+		footprint.spread = std::max(footprint.spread, std::acos(c));
+	}
+}
+
+int qrcode::crop_mesh(const Eigen::MatrixXd & verticles, const Eigen::MatrixXi & facets, const RayFootprint & footprint, Eigen::MatrixXi & cropped, Eigen::VectorXi & facet_map)
+{
+	QR_TRACE_SCOPE("qrcode::crop_mesh");
+	const double slack = 1e-6;
+	const int n = facets.rows();
+
+	Eigen::Vector3d corner[8];
+	for (int k = 0; k < 8; k++) corner[k] = footprint.box.corner(static_cast<Eigen::AlignedBox3d::CornerType>(k));
+	const double extent = footprint.box.isEmpty() ? 0 : footprint.box.diagonal().norm();
+
+	/*Double cone around each light: axis towards the box centre, half angle to its farthest corner*/
+	struct Cone
+	{
+		Eigen::Vector3d apex, axis;
+		double angle;
+	};
+	std::vector<Cone> cones;
+	for (int s = 0; s < footprint.sources.size(); s++) {
+		Cone cone;
+		cone.apex = footprint.sources[s];
+		cone.axis = footprint.box.center() - cone.apex;
+		double d = cone.axis.norm();
+
+		if (footprint.box.isEmpty()) continue;
+		if (footprint.box.exteriorDistance(cone.apex) == 0 || d < 1e-12) {
+			cone.angle = igl::PI;
+		}
+		else {
+			cone.axis /= d;
+			cone.angle = 0;
+			for (int k = 0; k < 8; k++) {
+				Eigen::Vector3d w = (corner[k] - cone.apex).normalized();
+				cone.angle = std::max(cone.angle, std::acos(std::max(-1.0, std::min(1.0, w.dot(cone.axis)))));
+			}
+		}
+		cones.push_back(cone);
+	}
+
+	/*Behind the box for every normal: w = q - corner inside the cone around -axis of half angle pi/2 - spread*/
+	const bool ambient = footprint.ambient && !footprint.box.isEmpty();
+	const double behind = std::sin(std::min(footprint.spread, igl::PI / 2));
+
+	std::vector<char> keep(n, 0);
+	const auto test = [&](const int f) {
+		Eigen::Vector3d v[3];
+		for (int k = 0; k < 3; k++) v[k] = verticles.row(facets(f, k)).transpose();
+
+		if (ambient) {
+			if (footprint.spread >= igl::PI / 2) {
+				keep[f] = 1;
+				return;
+			}
+			for (int k = 0; k < 3 && !keep[f]; k++)
+				for (int c = 0; c < 8; c++) {
+					Eigen::Vector3d w = v[k] - corner[c];
+					if (-footprint.axis.dot(w) <= w.norm()*behind + slack*(1 + extent)) {
+						keep[f] = 1;
+						break;
+					}
+				}
+			if (keep[f]) return;
+		}
+
+		/*Bounding sphere of the facet against each light cone*/
+		Eigen::Vector3d centre = (v[0] + v[1] + v[2]) / 3;
+		double radius = std::max((v[0] - centre).norm(), std::max((v[1] - centre).norm(), (v[2] - centre).norm()));
+
+		for (int s = 0; s < cones.size(); s++) {
+			const Cone &cone = cones[s];
+			Eigen::Vector3d w = centre - cone.apex;
+			double d = w.norm();
+
+			if (cone.angle >= igl::PI / 2 || d <= radius + slack) {
+				keep[f] = 1;
+				return;
+			}
+
+			double theta = std::acos(std::min(1.0, std::abs(w.dot(cone.axis)) / d));
+			if (theta <= cone.angle + std::asin(std::min(1.0, radius / d)) + slack) {
+				keep[f] = 1;
+				return;
+			}
+		}
+	};
+	qrcode::parallel_for(n, test);
+
+	return gather(facets, keep, cropped, facet_map);
+}
+
+int qrcode::crop_to_screen(const Eigen::MatrixXd & verticles, const Eigen::MatrixXi & facets, const Eigen::Matrix4f & model, const Eigen::Matrix4f & proj, const Eigen::Vector4f & viewport,
+	const Eigen::AlignedBox2f & rect, float padding, Eigen::MatrixXi & cropped, Eigen::VectorXi & facet_map)
+{
+	QR_TRACE_SCOPE("qrcode::crop_to_screen");
+	const int n = facets.rows();
+
+	/*Clip coordinates of every vertex in one product*/
+	Eigen::MatrixXd H(verticles.rows(), 4);
+	H.leftCols(3) = verticles;
+	H.col(3).setOnes();
+	Eigen::MatrixXd clip = H*(proj*model).cast<double>().transpose();
+
+	Eigen::VectorXd w = clip.col(3);
+	Eigen::ArrayXd sx = (clip.col(0).array() / w.array()*0.5 + 0.5)*viewport(2) + viewport(0);
+	Eigen::ArrayXd sy = (clip.col(1).array() / w.array()*0.5 + 0.5)*viewport(3) + viewport(1);
+
+	const double x0 = rect.min()(0) - padding, x1 = rect.max()(0) + padding;
+	const double y0 = rect.min()(1) - padding, y1 = rect.max()(1) + padding;
+
+	std::vector<char> keep(n, 0);
+	const auto test = [&](const int f) {
+		double lx = std::numeric_limits<double>::max(), hx = -lx, ly = lx, hy = -lx;
+		for (int k = 0; k < 3; k++) {
+			int v = facets(f, k);
+			if (!(w(v) > 1e-12)) {
+				keep[f] = 1;
+				return;
+			}
+			lx = std::min(lx, sx(v));
+			hx = std::max(hx, sx(v));
+			ly = std::min(ly, sy(v));
+			hy = std::max(hy, sy(v));
+		}
+		keep[f] = hx >= x0 && lx <= x1 && hy >= y0 && ly <= y1;
+	};
+	qrcode::parallel_for(n, test);
+
+	return gather(facets, keep, cropped, facet_map);
+}
@@ -0,0 +1,73 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CROP_MESH_H_
+#define CROP_MESH_H_
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <Eigen/dense>
+#include <Eigen/Geometry>
+#include <igl/PI.h>
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	/*
+	Conservative bound of every ray a pass traces from the QR region: shadow rays
+	from points inside box towards point lights, and, when ambient is set,
+	hemisphere rays around normals that lie within spread of axis.
+	*/
+	struct RayFootprint
+	{
+		Eigen::AlignedBox3d box;//every ray origin
+		std::vector<Eigen::Vector3d> sources;
+		bool ambient;
+		Eigen::Vector3d axis;
+		double spread;//radians, >= pi/2 keeps the whole space in front of the box
+	};
+
+	/*Footprint of the given origins; normals are only read when ambient is set*/
+	void ray_footprint(const std::vector<Eigen::Vector3f> &position, const std::vector<Eigen::Vector3f> &normal, const std::vector<Eigen::Vector3f> &sources,
+		bool ambient, RayFootprint &footprint);
+
+	//************************************
+	// Method:    qrcode::crop_mesh
+	//
+	// Keeps the facets a footprint ray can reach. A shadow ray from p towards L lies on
+	// the line through L and p, so facets whose bounding sphere misses the double cone
+	// around L that holds the box are dropped; an ambient ray leaves its origin in
+	// front of the normal, so facets entirely behind the box for every normal in the
+	// cone are dropped. Both tests only drop facets no ray can hit: any-hit queries on
+	// the cropped mesh answer exactly as on the whole mesh, and facet_map turns a hit
+	// id back into the original facet.
+	//
+	// @param Eigen::VectorXi & facet_map  row of cropped -> row of facets
+	// @return kept facets
+	//************************************
+	int crop_mesh(const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets, const RayFootprint &footprint, Eigen::MatrixXi &cropped, Eigen::VectorXi &facet_map);
+
+	//************************************
+	// Method:    qrcode::crop_to_screen
+	//
+	// Keeps the facets whose projection overlaps a window rectangle, for rays cast
+	// through the pixels of that rectangle. The vertices are transformed once; a facet
+	// with a vertex at or behind the eye is always kept since its projection is not
+	// bounded by its corners.
+	//
+	// @param Eigen::AlignedBox2f & rect  window coordinates, same convention as igl::unproject_ray
+	// @param float padding  pixels added around rect
+	// @param Eigen::VectorXi & facet_map  row of cropped -> row of facets
+	// @return kept facets
+	//************************************
+	int crop_to_screen(const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets, const Eigen::Matrix4f &model, const Eigen::Matrix4f &proj, const Eigen::Vector4f &viewport,
+		const Eigen::AlignedBox2f &rect, float padding, Eigen::MatrixXi &cropped, Eigen::VectorXi &facet_map);
+}
+
+#endif // !CROP_MESH_H_
@@ -0,0 +1,191 @@
+#include "depth_solver.h"
+
+void qrcode::depth_solver(GLOBAL & global, std::vector<Eigen::MatrixXi>& modules, Eigen::MatrixXi & both_modules, Eigen::VectorXf & upper_source, Eigen::VectorXf & lower_source,
+	Eigen::MatrixXf & AO, float target, float step, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, Eigen::MatrixXd & qr_verticals,
+	Eigen::VectorXf & depth, Eigen::MatrixXi & simu_gray_scale, DepthReport & report)
+{
+	QR_TRACE_SCOPE("qrcode::depth_solver");
+	/*Black modules and the light source each one is tuned against*/
+	std::vector<int> black;
+	std::vector<bool> upper;
+
+	for (int i = 0; i < global.anti_indicatior.size(); i++) {
+		int y = global.anti_indicatior[i](0);
+		int x = global.anti_indicatior[i](1);
+
+		if (modules[0](y, x) == 1) {
+			black.push_back(i);
+			upper.push_back(true);
+		}
+		else if (modules[1](y, x) == 1) {
+			black.push_back(i);
+			upper.push_back(false);
+		}
+	}
+
+	const int n = black.size();
+
+	/*lo is known too bright, hi is known dark enough; depth 0 is never evaluated*/
+	struct Bracket
+	{
+		float lo, hi, f_lo, f_hi, grow;
+		bool has_lo, has_hi, active;
+		int side;
+	};
+
+	std::vector<Bracket> bracket(n);
+	for (int k = 0; k < n; k++) bracket[k] = { 0.f, 0.f, 0.f, 0.f, step, false, false, true, 0 };
+
+	const float tolerance = step / 4;
+	const int max_rounds = 64;
+
+	report.iterations.setZero(n);
+	report.error.setZero(n);
+	report.open.clear();
+
+	Eigen::MatrixXf qr_position, qr_normal;
+	bool verify = false;
+
+	/*Only the QR grid moves while carving, the rest of the scene is prepared once*/
+	/*Iteration dumps share the static rows and write in the background*/
+	qrcode::MeshParts dump;
+	dump.verticles.push_back(nullptr);
+	dump.verticles.push_back(std::make_shared<const Eigen::MatrixXd>(verticles.bottomRows(verticles.rows() - global.qr_verticals.rows())));
+	dump.facets.push_back(std::make_shared<const Eigen::MatrixXi>(facets));
+	std::vector<std::future<bool>> pending;
+
+	qrcode::HeightField field;
+	std::vector<Eigen::Vector3f> sources = { upper_source, lower_source };
+	field.init(global, verticles, facets, sources);
+
+	for (report.rounds = 0; report.rounds < max_rounds; report.rounds++) {
+		QR_TRACE_SCOPE("depth_solver round");
+
+		/*Propagate depths through the neighbour coupling and re-carve*/
+		qrcode::patch_rows(black, depth, both_modules, global);
+
+		qrcode::carving_down(global, qr_verticals);
+		verticles.block(0, 0, global.qr_verticals.rows(), 3) = qr_verticals;
+		field.update(qr_verticals);
+		qrcode::pre_pixel_normal(global, qr_verticals, qr_position, qr_normal);
+
+		/*Trace open brackets only, or every module when verifying*/
+		std::vector<int> upper_id, lower_id;
+		std::vector<Eigen::Vector3f> upper_position, lower_position;
+
+		for (int k = 0; k < n; k++) {
+			if (!(verify || bracket[k].active)) continue;
+
+			if (upper[k]) {
+				upper_id.push_back(k);
+				upper_position.push_back(qr_position.row(black[k]).transpose());
+			}
+			else {
+				lower_id.push_back(k);
+				lower_position.push_back(qr_position.row(black[k]).transpose());
+			}
+		}
+
+		Eigen::Matrix<bool, Eigen::Dynamic, 1> upper_condition, lower_condition;
+		qrcode::light(field, upper_source, upper_position, upper_condition);
+		qrcode::light(field, lower_source, lower_position, lower_condition);
+
+		std::vector<int> evaluated(upper_id);
+		evaluated.insert(evaluated.end(), lower_id.begin(), lower_id.end());
+
+		const auto update = [&](const int e) {
+			const int k = evaluated[e];
+			const int i = black[k];
+			int y = global.anti_indicatior[i](0);
+			int x = global.anti_indicatior[i](1);
+
+			bool lighted = e < upper_id.size() ? upper_condition(e) : lower_condition(e - upper_id.size());
+			Eigen::Vector3f source = upper[k] ? upper_source : lower_source;
+			Eigen::Vector3f position = qr_position.row(i).transpose();
+			Eigen::Vector3f dir = (source - position).normalized();
+
+			int gray = qrcode::light_to_gray(AO(y, x), (lighted ? 1.f : 0.f)*dir.dot(qr_normal.row(i).transpose()));
+			float f = gray - target;
+
+			simu_gray_scale(y, x) = gray;
+			report.error(k) = f;
+
+			Bracket &b = bracket[k];
+
+			if (!b.active) {
+				/*A neighbour moved this module back into the light: search again from here*/
+				if (f > 0) {
+					b = { depth(i), 0.f, f, 0.f, step, true, false, true, 0 };
+					depth(i) += step;
+				}
+				return;
+			}
+
+			report.iterations(k)++;
+
+			if (f > 0) {
+				if (b.side == 1 && b.has_hi) b.f_hi *= 0.5f;
+				b.lo = depth(i);
+				b.f_lo = f;
+				b.has_lo = true;
+				b.side = 1;
+			}
+			else {
+				if (b.side == -1 && b.has_lo) b.f_lo *= 0.5f;
+				b.hi = depth(i);
+				b.f_hi = f;
+				b.has_hi = true;
+				b.side = -1;
+			}
+
+			if (b.has_hi && b.hi - b.lo <= tolerance) {
+				b.active = false;
+				depth(i) = b.hi;
+				return;
+			}
+
+			/*Bracketing: grow geometrically until the module turns dark*/
+			if (!b.has_hi) {
+				depth(i) = b.lo + b.grow;
+				b.grow *= 2;
+				return;
+			}
+
+			/*Refinement: false position, bisection while the shallow end is unknown*/
+			float next = b.has_lo ? b.hi - b.f_hi*(b.hi - b.lo) / (b.f_hi - b.f_lo) : 0.5f*(b.lo + b.hi);
+			float margin = 0.1f*(b.hi - b.lo);
+			depth(i) = std::min(std::max(next, b.lo + margin), b.hi - margin);
+		};
+
+		qrcode::parallel_for(evaluated.size(), update);
+
+		dump.verticles[0] = std::make_shared<const Eigen::MatrixXd>(qr_verticals);
+		pending.push_back(qrcode::write_mesh_async(global.job.path("Optimization/iter_" + std::to_string(report.rounds) + ".ply"), dump));
+		qrcode::write_png(global.job.path("Optimization/iter_" + std::to_string(report.rounds) + ".png"), simu_gray_scale);
+
+		int open = 0;
+		for (int k = 0; k < n; k++) open += bracket[k].active ? 1 : 0;
+		report.open.push_back(open);
+
+		/*Stop once a full check finds every module still dark enough*/
+		if (verify && open == 0) break;
+		verify = (open == 0);
+	}
+
+	for (int i = 0; i < pending.size(); i++) pending[i].get();
+
+	/*Leave the geometry at the solved depths*/
+	qrcode::patch_rows(black, depth, both_modules, global);
+	qrcode::carving_down(global, qr_verticals);
+	verticles.block(0, 0, global.qr_verticals.rows(), 3) = qr_verticals;
+
+	if (n > 0) {
+		int bright = 0;
+		for (int k = 0; k < n; k++) bright += report.error(k) > 0 ? 1 : 0;
+
+		std::cout << "Depth solver rounds: " << report.rounds
+			<< " evaluations per module: " << report.iterations.cast<float>().mean() << " (max " << report.iterations.maxCoeff() << ")"
+			<< " modules above target: " << bright
+			<< " worst error: " << report.error.maxCoeff() << std::endl;
+	}
+}
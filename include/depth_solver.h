@@ -0,0 +1,53 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef DEPTH_SOLVER_H_
+#define DEPTH_SOLVER_H_
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <Eigen/dense>
+#include "global.h"
+#include "carving_down.h"
+#include "pre_pixel_normal.h"
+#include "Light.h"
+#include "writePNG.h"
+#include "write_mesh.h"
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	struct DepthReport
+	{
+		Eigen::VectorXi iterations;//gray evaluations spent on each black module
+		Eigen::VectorXf error;//final simulated gray minus target, <=0 means dark enough
+		int rounds;//full re-trace rounds
+		std::vector<int> open;//modules still searching after each round
+	};
+
+	//************************************
+	// Method:    qrcode::depth_solver
+	//
+	// Searches the carving depth of every black module independently: the depth is first
+	// bracketed by doubling, then refined by false position (Illinois) inside the bracket.
+	// All modules advance together so one re-trace serves every open bracket, and the
+	// neighbour coupling of qrcode::patch is re-applied after each round. Modules that
+	// turn bright again because of their neighbours are reopened in a final check.
+	//
+	// @param std::vector<Eigen::MatrixXi> & modules  upper and lower black modules
+	// @param Eigen::MatrixXf & AO  ambient term of every cell
+	// @param float target  gray value a black module must not exceed
+	// @param float step  initial bracket growth; a quarter of it is the depth tolerance
+	// @param Eigen::VectorXf & depth  initial guess in, solved depth out (per cell)
+	//************************************
+	void depth_solver(GLOBAL &global, std::vector<Eigen::MatrixXi> &modules, Eigen::MatrixXi &both_modules, Eigen::VectorXf &upper_source, Eigen::VectorXf &lower_source,
+		Eigen::MatrixXf &AO, float target, float step, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, Eigen::MatrixXd &qr_verticals,
+		Eigen::VectorXf &depth, Eigen::MatrixXi &simu_gray_scale, DepthReport &report);
+}
+
+#endif // !DEPTH_SOLVER_H_
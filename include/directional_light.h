@@ -15,7 +15,6 @@
 #include<igl/viewer/Viewer.h>
 #include<igl/matlab/matlabinterface.h>
 #include<igl/Timer.h>
-#include<igl/writeOBJ.h>
 #include "global.h"
 #include "carving_down.h"
 #include "findhole.h"
@@ -25,8 +24,15 @@
 #include "pre_pixel_normal.h"
 #include "module_adapter.h"
 #include "Light.h"
+#include "depth_solver.h"
 #include "ambient_occlusion.h"
+#include "validation.h"
+#include "render.h"
+#include "memory_budget.h"
+#include "pipeline.h"
 #include "writePNG.h"
+#include "write_mesh.h"
+#include "trace.h"
 namespace qrcode {
 
 	void directional_light(igl::viewer::Viewer & viewer, Engine * engine, GLOBAL& global, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets);
@@ -2,6 +2,10 @@
 
 void qrcode::find_hole(Engine * engine, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::find_hole");
+	/*Budget mode frees the hitmap after the first run; the holes only depend on it and under_control*/
+	if (!global.projection.is_open() && global.hitmap.empty() && !global.hole_facet.empty()) return;
+
 	Eigen::MatrixXi label;
 	qrcode::bwlabel(engine, global.under_control, 4, label);
 	
@@ -12,7 +16,7 @@ void qrcode::find_hole(Engine * engine, GLOBAL & global)
 
 	for (int y = 0; y < label.rows(); y++)
 		for (int x = 0; x < label.cols(); x++)
-			facets[label(y, x) - 1].push_back(global.hitmap[y*label.cols() + x].id);
+			facets[label(y, x) - 1].push_back(qrcode::projected_hit(global, y*label.cols() + x).id);
 
 	for (int i = 0; i < index; i++) {
 		std::vector<int> temp = facets[i];
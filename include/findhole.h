@@ -14,6 +14,7 @@
 #include <Eigen/dense>
 #include "global.h"
 #include "bwlabel.h"
+#include "trace.h"
 namespace qrcode {
 	void find_hole(Engine *engine,GLOBAL &global);
 }
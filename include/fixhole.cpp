@@ -1,101 +1,90 @@
 #include "fixhole.h"
 
+namespace {
+	/*Triangle keeps its random seed and arithmetic constants in globals*/
+	std::mutex triangle_lock;
+}
+
 void qrcode::fix_hole(Engine * engine, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::fix_hole");
+	global.patches.clear();
 	global.patches.resize(global.component.size());
 
-	for (int i = 0; i < global.component.size(); i++) {
+	const int qr_rows = global.qr_verticals.rows();
+	const int cols = global.indicator.empty() ? 0 : global.indicator[0].size();
+
+	/*Corner k of cell p is grid point (y + k%2, x + k/2), the neighbouring cells repeat it under other rows*/
+	const auto grid_point = [&global, &cols](int v)->long long {
+		const Eigen::Vector2i &yx = global.anti_indicatior[v / 4];
+		return static_cast<long long>(yx(0) + (v % 4) % 2)*(cols + 1) + yx(1) + (v % 4) / 2;
+	};
 
-		Eigen::MatrixXf verticals;
-		Eigen::MatrixXi edges;
+	/*Components are independent, each one fills its own slot of patches*/
+	const auto fix = [&](const int i) {
+		std::vector<int> IA;//patch vertex -> row of the merged mesh
+		std::vector<Eigen::Vector2i> edge_list;
 		Eigen::MatrixXf seed(global.component[i].size(), 4);
 
 		/*Reconstruct island verticals and edges*/
-		int size = 0;
-		for (int j = 0; j < global.component[i].size(); j++) size += global.islands[global.component[i][j]].rows();
-
-		Eigen::MatrixXf island_v(2 * size, 4);
-		
-		int index = 0;
-		std::vector<int> queue; 
-		
-		for (int j = 0; j < global.component[i].size(); j++) {
+		std::unordered_map<long long, int> island_id;
+		const auto island_vertex = [&](int v)->int {
+			auto found = island_id.emplace(grid_point(v), static_cast<int>(IA.size()));
+			if (found.second) IA.push_back(v);
+			return found.first->second;
+		};
 
+		for (int j = 0; j < global.component[i].size(); j++) {
 			int p = global.seeds[global.component[i][j]];
 			seed.row(j) << global.qr_verticals(p, 0), global.qr_verticals(p, 1), global.qr_verticals(p, 2), 0;
 
-			for (int k = 0; k < global.islands[global.component[i][j]].rows(); k++) {
-
-				Eigen::Vector2i pos = global.islands[global.component[i][j]].row(k);
-
-				island_v.row(index++) << global.qr_verticals(pos(0), 0), global.qr_verticals(pos(0), 1), global.qr_verticals(pos(0), 2), 0;
-				island_v.row(index++) << global.qr_verticals(pos(1), 0), global.qr_verticals(pos(1), 1), global.qr_verticals(pos(1), 2), 0;
-
-				queue.push_back(pos(0));
-				queue.push_back(pos(1));
-			}
+			const Eigen::MatrixXi &island = global.islands[global.component[i][j]];
+			for (int k = 0; k < island.rows(); k++)
+				edge_list.push_back(Eigen::Vector2i(island_vertex(island(k, 0)), island_vertex(island(k, 1))));
 		}
-		Eigen::MatrixXf island_vertex;
-		Eigen::VectorXi IAS, ICS;
-		igl::unique_rows(island_v, island_vertex, IAS, ICS);
-		
-		verticals = island_vertex;
-		edges.resize(size, 2);
-		for (int j = 0; j < edges.rows(); j++)  edges.row(j) << ICS(2 * j), ICS(2 * j + 1);
-		
-		/*Reconstruct hole verticals and edges*/
-
-		size = global.holes[i].rows();
-
-		Eigen::MatrixXf hole_v(2*size,4);
-
-		index = 0;
-		for (int j = 0; j < global.holes[i].rows(); j++) {
-
-			Eigen::Vector2i pos = global.holes[i].row(j);
-
-			hole_v.row(index++) << global.rest_verticals(pos(0), 0), global.rest_verticals(pos(0), 1), global.rest_verticals(pos(0), 2), 0;
-			hole_v.row(index++) << global.rest_verticals(pos(1), 0), global.rest_verticals(pos(1), 1), global.rest_verticals(pos(1), 2), 0;
 
+		/*Reconstruct hole verticals and edges*/
+		std::unordered_map<int, int> hole_id;
+		const auto hole_vertex = [&](int v)->int {
+			auto found = hole_id.emplace(v, static_cast<int>(IA.size()));
+			if (found.second) IA.push_back(v + qr_rows);
+			return found.first->second;
+		};
+
+		for (int j = 0; j < global.holes[i].rows(); j++)
+			edge_list.push_back(Eigen::Vector2i(hole_vertex(global.holes[i](j, 0)), hole_vertex(global.holes[i](j, 1))));
+
+		Eigen::MatrixXf verticals(IA.size(), 4);
+		for (int j = 0; j < IA.size(); j++) {
+			int v = IA[j];
+			if (v < qr_rows)
+				verticals.row(j) << global.qr_verticals(v, 0), global.qr_verticals(v, 1), global.qr_verticals(v, 2), 0;
+			else
+				verticals.row(j) << global.rest_verticals(v - qr_rows, 0), global.rest_verticals(v - qr_rows, 1), global.rest_verticals(v - qr_rows, 2), 0;
 		}
 
-		Eigen::MatrixXf hole_vertex;
-		Eigen::VectorXi IAH, ICH;
-		igl::unique_rows(hole_v, hole_vertex, IAH, ICH);
-		
-		verticals.conservativeResize(verticals.rows() + hole_vertex.rows(), 4);
-		
-		verticals.block(island_vertex.rows(), 0, hole_vertex.rows(), 4) = hole_vertex;
-
-		
-		edges.conservativeResize(edges.rows() + size, 2);
-		for (int j = -size; j < 0; j++) edges.row(edges.rows() + j) << ICH(2 * (j + size)) + island_vertex.rows(), ICH(2 * (j + size) + 1) + island_vertex.rows();
+		Eigen::MatrixXi edges(edge_list.size(), 2);
+		for (int j = 0; j < edge_list.size(); j++) edges.row(j) = edge_list[j].transpose();
 
 		verticals = (global.mode*verticals.transpose()).transpose();
-
 		verticals.conservativeResize(verticals.rows(), 2);
 
 		seed = (global.mode*seed.transpose()).transpose();
 		seed.conservativeResize(seed.rows(), 2);
 
-
-	
-
 		Eigen::MatrixXf nouse;
 		Eigen::MatrixXi patches;
+		{
+			std::lock_guard<std::mutex> guard(triangle_lock);
+			igl::triangle::triangulate(verticals, edges, seed, "0.5", nouse, patches);
+		}
 
-		igl::triangle::triangulate(verticals, edges, seed, "0.5", nouse,patches);
-
-		Eigen::VectorXi IA(IAS.rows() + IAH.rows());
-		for (int j = 0; j < IAS.rows(); j++) IA(j) = queue[IAS(j)];
-		for (int j = 0; j < IAH.rows(); j++) IA(IAS.rows() + j) = global.holes[i](IAH(j) / 2, IAH(j) % 2) + global.qr_verticals.rows();
-
-		global.patches[i].resize(patches.rows(), patches.cols());
+		Eigen::MatrixXi &patch = global.patches[i];
+		patch.resize(patches.rows(), patches.cols());
 
 		for (int r = 0; r < patches.rows(); r++)
 			for (int c = 0; c < patches.cols(); c++)
-			global.patches[i](r, c) = IA(patches(r, c));
-
-	}
-
-} 
+				patch(r, c) = IA[patches(r, c)];
+	};
+	qrcode::parallel_for(global.component.size(), fix, 1);
+}
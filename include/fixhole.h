@@ -9,12 +9,21 @@
 #ifndef FIXHOLE_H_
 #define FIXHOLE_H_
 
+#include <vector>
+#include <mutex>
+#include <unordered_map>
 #include<igl/matlab//matlabinterface.h>
 #include <Eigen/dense>
-#include<igl/unique.h>
 #include<igl/triangle/triangulate.h>
 #include "global.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
+	/*
+	Triangulates every hole component between its QR islands and the rim of the cut,
+	in the projection plane. Island corners are merged by grid point and rim vertices
+	by index; components are prepared in parallel and write their own slot of patches.
+	*/
 	void fix_hole(Engine *engine,GLOBAL &global);
 }
 #endif // !FIXHOLE_H_
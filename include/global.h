@@ -11,6 +11,10 @@
 #include<Eigen/Core>
 #include<igl/Hit.h>
 #include "QRinfo.h"
+#include "ao_cache.h"
+#include "projection_store.h"
+#include "pipeline.h"
+#include "job.h"
 
 namespace qrcode {
 	struct GLOBAL
@@ -34,6 +38,9 @@ namespace qrcode {
 	    std::vector<igl::Hit> hitmap;//(s)
 		Eigen::MatrixXd hit_matrix;//(pixels.size+2*border)*scale+1//(s)
 
+		bool tiled_projection;//project into the mapped tile store instead of the four arrays above
+		qrcode::ProjectionStore projection;//open after a tiled projection, read through projected_point/direct/hit
+
 		Eigen::MatrixXi under_control;//(s)
 		std::vector<Eigen::Vector2i> anti_indicatior;//(s)
 		std::vector<std::vector<Eigen::Vector2i>> indicator;//(pixels.size+2*border)*scale(s)
@@ -57,11 +64,20 @@ namespace qrcode {
 		
 		
 		Eigen::VectorXd carve_depth;//(pixels.size+2*border)*scale;(s)
+		Eigen::MatrixXd carve_direct;//projection direction of every qr_verticals row, filled by carving_down; clear when qr_verticals change
 
 		float latitude_upper,latitude_lower,longitude,distance;
+		int memory_limit;//MB, stages whose projected peak is above it are refused and intermediates are freed early; 0 for no limit
+		int seed;//job seed of every random stream, handed to each sampler; same seed same output whatever the thread count
+		bool ao_benchmark;//print AO error against ray count while carving
+		std::vector<Eigen::Vector2f> validation_angles;//(latitude, longitude), empty for the three around the carving lights
 
 		std::vector<Eigen::Vector3i> black_module_segments;
 
+		qrcode::AOCache ao_cache;//AO of QR cells on the current merged mesh
+		qrcode::JobContext job;//output folder and stage handoff of this job
+		qrcode::Pipeline pipeline;//directional_light stages and their results, "projection" is touched by every new projection
+
 	};
 }
 #endif // !QR_GLOBAL_H_
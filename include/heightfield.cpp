@@ -0,0 +1,268 @@
+#include "heightfield.h"
+
+void qrcode::HeightField::init(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, const std::vector<Eigen::Vector3f>& sources)
+{
+	QR_TRACE_SCOPE("HeightField::init");
+	rows = global.indicator.size();
+	cols = rows > 0 ? global.indicator[0].size() : 0;
+	int n = global.anti_indicatior.size();
+	qr_rows = global.qr_verticals.rows();
+	this->sources = sources;
+
+	place = global.anti_indicatior;
+
+	cell.setConstant(rows, cols, -1);
+	for (int y = 0; y < rows; y++)
+		for (int x = 0; x < cols; x++)
+			cell(y, x) = global.indicator[y][x](1);
+
+	tri = global.qr_facets;
+
+	/*Own two facets plus the link facets shared with each neighbour*/
+	std::vector<std::vector<int>> touch(n);
+	const int dy[4] = { 0, 0, -1, 1 };
+	const int dx[4] = { -1, 1, 0, 0 };
+
+	for (int p = 0; p < n; p++) {
+		int y = global.anti_indicatior[p](0);
+		int x = global.anti_indicatior[p](1);
+
+		touch[p].push_back(2 * p);
+		touch[p].push_back(2 * p + 1);
+
+		for (int k = 0; k < 4; k++) {
+			int link = global.patch_indicator[p](k);
+			if (link < 0) continue;
+
+			touch[p].push_back(2 * n + link);
+			int q = global.indicator[y + dy[k]][x + dx[k]](1);
+			if (q >= 0) touch[q].push_back(2 * n + link);
+		}
+	}
+
+	cell_start.assign(1, 0);
+	cell_tri.clear();
+	for (int p = 0; p < n; p++) {
+		cell_tri.insert(cell_tri.end(), touch[p].begin(), touch[p].end());
+		cell_start.push_back(cell_tri.size());
+	}
+
+	/*Plane of the uncarved grid*/
+	Eigen::MatrixXf P = global.qr_verticals.cast<float>();
+	origin = P.colwise().mean().transpose();
+
+	Eigen::Vector3f normal(0.f, 0.f, 0.f), along(0.f, 0.f, 0.f);
+	for (int p = 0; p < n; p++) {
+		Eigen::Vector3f a = P.row(4 * p).transpose();
+		Eigen::Vector3f b = P.row(4 * p + 1).transpose();
+		Eigen::Vector3f c = P.row(4 * p + 2).transpose();
+		normal += (b - a).cross(c - a);
+		along += c - a;
+	}
+
+	axis_h = normal.normalized();
+	axis_u = (along - along.dot(axis_h)*axis_h).normalized();
+	axis_v = axis_h.cross(axis_u);
+
+	/*Least squares affine map from the plane to grid coordinates*/
+	Eigen::MatrixXf A(P.rows(), 3), G(P.rows(), 2);
+	for (int i = 0; i < P.rows(); i++) {
+		int p = i / 4;
+		int u = (i % 4) % 2;
+		int v = (i % 4) / 2;
+		Eigen::Vector3f w = P.row(i).transpose() - origin;
+		A.row(i) << w.dot(axis_u), w.dot(axis_v), 1.f;
+		G.row(i) << global.anti_indicatior[p](1) + v, global.anti_indicatior[p](0) + u;
+	}
+	affine = A.colPivHouseholderQr().solve(G);
+
+	/*Static rest mesh and the hole patches touching the QR grid*/
+	std::vector<Eigen::RowVector3i> rest_f, seam_list;
+	for (int i = tri.rows(); i < facets.rows(); i++) {
+		if (facets.row(i).minCoeff() < qr_rows)
+			seam_list.push_back(facets.row(i));
+		else
+			rest_f.push_back(facets.row(i));
+	}
+
+	seam_v = verticles.cast<float>();
+	seam_f.resize(seam_list.size(), 3);
+	for (int i = 0; i < seam_list.size(); i++) seam_f.row(i) = seam_list[i];
+
+	this->rest_f.resize(rest_f.size(), 3);
+	for (int i = 0; i < rest_f.size(); i++) this->rest_f.row(i) = rest_f[i];
+
+	rest_v = verticles;
+	has_rest = false;
+	has_seam = seam_f.rows() > 0;
+	crop_box.setEmpty();
+
+	Eigen::MatrixXd qr_verticals = global.qr_verticals;
+	update(qr_verticals);
+}
+
+void qrcode::HeightField::update(Eigen::MatrixXd & qr_verticals)
+{
+	QR_TRACE_SCOPE("HeightField::update");
+	V = qr_verticals.cast<float>();
+
+	/*Widen the walk by the worst map error and bound the heights*/
+	margin = 0.f;
+	h_min = std::numeric_limits<float>::max();
+	h_max = -std::numeric_limits<float>::max();
+
+	for (int i = 0; i < V.rows(); i++) {
+		Eigen::Vector2i yx = place[i / 4];
+		Eigen::Vector3f w = V.row(i).transpose() - origin;
+		Eigen::RowVector2f g = Eigen::RowVector3f(w.dot(axis_u), w.dot(axis_v), 1.f)*affine;
+
+		margin = std::max(margin, std::abs(g(0) - (yx(1) + (i % 4) / 2)));
+		margin = std::max(margin, std::abs(g(1) - (yx(0) + (i % 4) % 2)));
+		h_min = std::min(h_min, w.dot(axis_h));
+		h_max = std::max(h_max, w.dot(axis_h));
+	}
+
+	/*The carved grid left the box the rest BVH was cropped for*/
+	Eigen::AlignedBox3d box;
+	box.setEmpty();
+	for (int i = 0; i < qr_verticals.rows(); i++) box.extend(qr_verticals.row(i).transpose());
+	if (!crop_box.contains(box)) crop_rest();
+
+	if (has_seam) {
+		seam_v.block(0, 0, V.rows(), 3) = V;
+		seam.deinit();
+		seam.init(seam_v, seam_f);
+	}
+}
+
+void qrcode::HeightField::crop_rest()
+{
+	QR_TRACE_SCOPE("HeightField::crop_rest");
+	/*Grow by a quarter of the grid so a few carving rounds fit without a rebuild*/
+	crop_box.setEmpty();
+	for (int i = 0; i < V.rows(); i++) crop_box.extend(V.row(i).transpose().cast<double>());
+	double grow = crop_box.isEmpty() ? 0 : 0.25*crop_box.diagonal().norm() + 1e-6;
+	crop_box.min().array() -= grow;
+	crop_box.max().array() += grow;
+
+	std::vector<Eigen::Vector3f> corner;
+	for (int k = 0; k < 8; k++) corner.push_back(crop_box.corner(static_cast<Eigen::AlignedBox3d::CornerType>(k)).cast<float>());
+
+	RayFootprint footprint;
+	qrcode::ray_footprint(corner, std::vector<Eigen::Vector3f>(), sources, false, footprint);
+
+	Eigen::MatrixXi F;
+	Eigen::VectorXi facet_map;
+	int kept = qrcode::crop_mesh(rest_v, rest_f, footprint, F, facet_map);
+
+	if (has_rest) rest.deinit();
+	has_rest = kept > 0;
+	if (has_rest) rest.init(seam_v, F);
+}
+
+bool qrcode::HeightField::intersect(const Eigen::Vector3f & s, const Eigen::Vector3f & dir) const
+{
+	const float tnear = 1e-3f;
+
+	if (intersect_grid(s, dir, tnear))
+		return true;
+
+	igl::Hit hit;
+	if (has_seam && seam.intersectRay(s, dir, hit, tnear))
+		return true;
+
+	return has_rest && rest.intersectRay(s, dir, hit, tnear);
+}
+
+bool qrcode::HeightField::intersect_grid(const Eigen::Vector3f & s, const Eigen::Vector3f & dir, float tnear) const
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	const int reach = static_cast<int>(std::ceil(margin));
+
+	Eigen::Vector3f w = s - origin;
+	Eigen::RowVector2f g = Eigen::RowVector3f(w.dot(axis_u), w.dot(axis_v), 1.f)*affine;
+	Eigen::RowVector2f dg = Eigen::RowVector3f(dir.dot(axis_u), dir.dot(axis_v), 0.f)*affine;
+	float h = w.dot(axis_h);
+	float dh = dir.dot(axis_h);
+
+	/*Clip the ray to the height slab and the widened footprint*/
+	float t0 = tnear, t1 = inf;
+
+	const auto clip = [&t0, &t1, &inf](float p, float d, float lo, float hi)->bool {
+		if (std::abs(d) < 1e-12f) return p >= lo && p <= hi;
+		float a = (lo - p) / d;
+		float b = (hi - p) / d;
+		if (a > b) std::swap(a, b);
+		t0 = std::max(t0, a);
+		t1 = std::min(t1, b);
+		return t0 <= t1;
+	};
+
+	if (!clip(h, dh, h_min - 1e-4f, h_max + 1e-4f)) return false;
+	if (!clip(g(0), dg(0), -reach - 1.f, cols + reach + 1.f)) return false;
+	if (!clip(g(1), dg(1), -reach - 1.f, rows + reach + 1.f)) return false;
+
+	/*2D DDA over the grid cells crossed between t0 and t1*/
+	float gx = g(0) + t0*dg(0);
+	float gy = g(1) + t0*dg(1);
+	int x = static_cast<int>(std::floor(gx));
+	int y = static_cast<int>(std::floor(gy));
+
+	int step_x = dg(0) > 0 ? 1 : -1;
+	int step_y = dg(1) > 0 ? 1 : -1;
+	float delta_x = dg(0) != 0 ? std::abs(1.f / dg(0)) : inf;
+	float delta_y = dg(1) != 0 ? std::abs(1.f / dg(1)) : inf;
+	float next_x = dg(0) != 0 ? t0 + ((step_x > 0 ? x + 1 - gx : gx - x))*delta_x : inf;
+	float next_y = dg(1) != 0 ? t0 + ((step_y > 0 ? y + 1 - gy : gy - y))*delta_y : inf;
+
+	int guard = 2 * (rows + cols + 4 * reach + 8);
+
+	while (guard-- > 0) {
+		for (int v = y - reach; v <= y + reach; v++)
+			for (int u = x - reach; u <= x + reach; u++)
+				if (intersect_cell(v, u, s, dir, tnear)) return true;
+
+		if (std::min(next_x, next_y) > t1) break;
+
+		if (next_x < next_y) {
+			x += step_x;
+			next_x += delta_x;
+		}
+		else {
+			y += step_y;
+			next_y += delta_y;
+		}
+	}
+	return false;
+}
+
+bool qrcode::HeightField::intersect_cell(int y, int x, const Eigen::Vector3f & s, const Eigen::Vector3f & dir, float tnear) const
+{
+	if (y < 0 || y >= rows || x < 0 || x >= cols || cell(y, x) < 0)
+		return false;
+
+	int p = cell(y, x);
+
+	/*Moller-Trumbore against every triangle touching the cell*/
+	for (int k = cell_start[p]; k < cell_start[p + 1]; k++) {
+		Eigen::Vector3f a = V.row(tri(cell_tri[k], 0)).transpose();
+		Eigen::Vector3f e1 = V.row(tri(cell_tri[k], 1)).transpose() - a;
+		Eigen::Vector3f e2 = V.row(tri(cell_tri[k], 2)).transpose() - a;
+
+		Eigen::Vector3f q = dir.cross(e2);
+		float det = e1.dot(q);
+		if (std::abs(det) < 1e-12f) continue;
+
+		float inv = 1.f / det;
+		Eigen::Vector3f r = s - a;
+		float u = r.dot(q)*inv;
+		if (u < 0.f || u > 1.f) continue;
+
+		Eigen::Vector3f m = r.cross(e1);
+		float v = dir.dot(m)*inv;
+		if (v < 0.f || u + v > 1.f) continue;
+
+		if (e2.dot(m)*inv > tnear) return true;
+	}
+	return false;
+}
@@ -0,0 +1,73 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEIGHTFIELD_H_
+#define HEIGHTFIELD_H_
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+#include <Eigen/dense>
+#include <igl/embree/EmbreeIntersector.h>
+#include <igl/Hit.h>
+#include "global.h"
+#include "crop_mesh.h"
+#include "trace.h"
+namespace qrcode {
+
+	/*
+	Shadow test for the merged mesh that keeps the carved QR grid out of the BVH.
+	The grid is fitted once with a plane and an affine map from the plane to grid
+	coordinates; a ray is walked over that map with a 2D DDA and only the triangles
+	of the visited cells are tested. The map error of the carved vertices widens the
+	walk, so the grid test is exact. The rest of the model is static while carving,
+	its BVH is built once over the facets the shadow rays of the QR region can reach
+	(qrcode::crop_mesh), and the few hole patch facets that touch QR vertices are
+	rebuilt on every update.
+	*/
+	class HeightField
+	{
+	public:
+		/*verticles and facets are the merged mesh, the QR grid occupies their first rows; sources are the lights intersect is called towards*/
+		void init(GLOBAL &global, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, const std::vector<Eigen::Vector3f> &sources);
+		/*Carved QR verticals, same layout as global.qr_verticals*/
+		void update(Eigen::MatrixXd &qr_verticals);
+		bool intersect(const Eigen::Vector3f &s, const Eigen::Vector3f &dir) const;
+
+	private:
+		bool intersect_grid(const Eigen::Vector3f &s, const Eigen::Vector3f &dir, float tnear) const;
+		bool intersect_cell(int y, int x, const Eigen::Vector3f &s, const Eigen::Vector3f &dir, float tnear) const;
+		/*Rebuilds the rest BVH over the facets reachable from a grown box around the carved grid*/
+		void crop_rest();
+
+		int rows, cols;
+		Eigen::MatrixXi cell;//grid cell -> anti_indicatior index, -1 outside control
+		std::vector<Eigen::Vector2i> place;//anti_indicatior index -> (y, x)
+		std::vector<int> cell_start, cell_tri;//triangles touching each cell, rows of tri
+		Eigen::MatrixXi tri;//QR grid facets
+		Eigen::MatrixXf V;//carved QR verticals
+
+		Eigen::Vector3f origin, axis_u, axis_v, axis_h;
+		Eigen::Matrix<float, 3, 2> affine;//(u,v,1) -> (grid x, grid y)
+		float margin, h_min, h_max;
+
+		Eigen::MatrixXf seam_v;
+		Eigen::MatrixXi seam_f;
+		int qr_rows;
+		bool has_rest, has_seam;
+		igl::embree::EmbreeIntersector rest, seam;
+
+		Eigen::MatrixXd rest_v;
+		Eigen::MatrixXi rest_f;//every static facet, rest holds the cropped subset
+		std::vector<Eigen::Vector3f> sources;
+		Eigen::AlignedBox3d crop_box;
+	};
+}
+
+#endif // !HEIGHTFIELD_H_
@@ -1,7 +1,22 @@
 #include "image_onto_mesh.h"
 #include <igl/unproject_onto_mesh.h>
-void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
+
+namespace {
+	/*Facets under the projected rectangle, padded by one module and a few pixels*/
+	void screen_facets(igl::viewer::Viewer &viewer, qrcode::GLOBAL &global, int size, const Eigen::Vector2f &center, Eigen::MatrixXi &cropped, Eigen::VectorXi &facet_map)
+	{
+		int scale = global.info.scale;
+		Eigen::AlignedBox2f rect(
+			Eigen::Vector2f(center(1) - scale, center(0) - (size + scale - 1)),
+			Eigen::Vector2f(center(1) + size + scale - 1, center(0) + scale));
+
+		qrcode::crop_to_screen(global.model_vertices, global.model_facets, viewer.core.view*viewer.core.model, viewer.core.proj, viewer.core.viewport,
+			rect, 2.f, cropped, facet_map);
+	}
+}
+bool qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::image_onto_mesh");
 	Eigen::MatrixXi modules, functions;
 	pixel_to_matrix(global.info.pixels, global.info.border, modules, functions);
 
@@ -18,6 +33,16 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 				for (int v = 0; v < scale; v++)
 					Modules(y*scale + u, x*scale + v) = modules(y, x);
 	
+	Eigen::Vector2f center; 
+	center << viewer.core.viewport(3) / 2 + (static_cast<float>(size) / 2), viewer.core.viewport(2) / 2 - (static_cast<float>(size) / 2);
+
+	global.projection.close();
+	if (global.tiled_projection) return qrcode::project_tiles(viewer, global, size, center);
+
+	Eigen::MatrixXi cropped;
+	Eigen::VectorXi facet_map;
+	screen_facets(viewer, global, size, center, cropped, facet_map);
+
 	std::vector<Eigen::Vector2i> position;
 
 	for (int y = -scale; y < size + scale; y++) {
@@ -26,15 +51,12 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 		}
 	}
 
-	Eigen::Vector2f center; 
-	center << viewer.core.viewport(3) / 2 + (static_cast<float>(size) / 2), viewer.core.viewport(2) / 2 - (static_cast<float>(size) / 2);
-
 	global.hitmap.resize((size + 2 * scale)*(size + 2 * scale));
 	global.source.resize(size*size, 3);
 	global.direct.resize(size*size, 3);
 	global.hit_matrix.resize(size*size, 3);
 
-	const auto &project = [&viewer,&position, &center, &size, &global](const int p) {
+	const auto &project = [&viewer,&position, &center, &size, &global, &cropped, &facet_map](const int p) {
 
 		Eigen::Vector2f pos = position[p].cast<float>() + center;
 
@@ -43,8 +65,10 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 		std::vector<igl::Hit> hits;
 
 		qrcode::unproject_onto_mesh(Eigen::Vector2f(pos(1), pos(0)), viewer.core.view*viewer.core.model, viewer.core.proj, viewer.core.viewport,
-			global.model_vertices, global.model_facets, src, dir, hits);
+			global.model_vertices, cropped, src, dir, hits);
 
+		/*Back to ids of model_facets*/
+		if (hits.front().t >= 0) hits.front().id = facet_map(hits.front().id);
 		global.hitmap[p] = hits.front();
 
 		int y = -position[p](0);
@@ -63,7 +87,7 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 			global.hit_matrix.row(y*size + x) = v.transpose();
 		}
 	};
-	igl::parallel_for((size+2*scale)*(size + 2 * scale), project, 1000);
+	qrcode::parallel_for((size+2*scale)*(size + 2 * scale), project);
 
 	/*Eigen::MatrixXd V(4 * (size - 1)*(size - 1), 3);
 	Eigen::MatrixXi F(2 * (size - 1)*(size - 1), 3);
@@ -151,7 +175,7 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 		}
 	};
 
-	igl::parallel_for((size - 1)*(size - 1), build, 1000);
+	qrcode::parallel_for((size - 1)*(size - 1), build);
 
 	Eigen::MatrixXi FP(4 * (size - 1)*(size - 2), 3);
 
@@ -170,4 +194,74 @@ void qrcode::image_onto_mesh(igl::viewer::Viewer & viewer, GLOBAL & global)
 	global.qr_facets.block(0, 0, F.rows(), 3) = F;
 	global.qr_facets.block(F.rows(), 0, FP.rows(), 3) = FP;*/
 
+	return true;
+}
+
+bool qrcode::project_tiles(igl::viewer::Viewer & viewer, GLOBAL & global, int size, const Eigen::Vector2f & center)
+{
+	QR_TRACE_SCOPE("qrcode::project_tiles");
+	int scale = global.info.scale;
+
+	if (!global.job.prepare() || !global.projection.create(global.job.path("projection.tiles"), size, scale)) {
+		std::cout << "Can not map " << global.job.path("projection.tiles") << std::endl;
+		return false;
+	}
+	ProjectionStore &store = global.projection;
+
+	/*The in memory arrays are not used in this mode*/
+	std::vector<igl::Hit>().swap(global.hitmap);
+	Eigen::MatrixXf().swap(global.source);
+	Eigen::MatrixXf().swap(global.direct);
+	Eigen::MatrixXd().swap(global.hit_matrix);
+
+	Eigen::MatrixXi cropped;
+	Eigen::VectorXi facet_map;
+	screen_facets(viewer, global, size, center, cropped, facet_map);
+
+	const Eigen::Matrix4f model_view = viewer.core.view*viewer.core.model;
+	const int side = store.padded_size();
+	const int tile = ProjectionStore::tile;
+
+	/*One tile at a time, its points in parallel, written straight into the mapping*/
+	for (int ty = 0; ty < store.tiles(); ty++) {
+		for (int tx = 0; tx < store.tiles(); tx++) {
+			const int y0 = ty*tile, x0 = tx*tile;
+			const int rows = std::min(tile, side - y0);
+			const int cols = std::min(tile, side - x0);
+
+			const auto project = [&](const int k) {
+				int py = y0 + k / cols;
+				int px = x0 + k % cols;
+				int y = py - scale;
+				int x = px - scale;
+
+				Eigen::Vector2f pos = Eigen::Vector2f(-y, x) + center;
+				Eigen::Vector3f src, dir;
+				std::vector<igl::Hit> hits;
+
+				qrcode::unproject_onto_mesh(Eigen::Vector2f(pos(1), pos(0)), model_view, viewer.core.proj, viewer.core.viewport,
+					global.model_vertices, cropped, src, dir, hits);
+
+				if (hits.front().t >= 0) hits.front().id = facet_map(hits.front().id);
+				ProjectionStore::Point &point = store.padded(py, px);
+				point.hit = hits.front();
+
+				if (y >= 0 && y < size && x >= 0 && x < size) {
+					const igl::Hit &hit = hits.front();
+					Eigen::Vector3d v0 = global.model_vertices.row(global.model_facets(hit.id, 0));
+					Eigen::Vector3d v1 = global.model_vertices.row(global.model_facets(hit.id, 1));
+					Eigen::Vector3d v2 = global.model_vertices.row(global.model_facets(hit.id, 2));
+					Eigen::Vector3d v = v0*(1 - hit.u - hit.v) + v1*hit.u + v2*hit.v;
+
+					for (int i = 0; i < 3; i++) {
+						point.point[i] = v(i);
+						point.source[i] = src(i);
+						point.direct[i] = dir(i);
+					}
+				}
+			};
+			qrcode::parallel_for(rows*cols, project);
+		}
+	}
+	return true;
 }
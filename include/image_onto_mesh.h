@@ -9,13 +9,20 @@
 #ifndef IMAGE_ONTO_MESH_H_
 #define IMAGE_ONTO_MESH_H_
 #include<vector>
+#include<algorithm>
+#include<iostream>
 #include<igl/matlab/matlabinterface.h>
 #include <igl/viewer/Viewer.h>
-#include <igl/parallel_for.h>
 #include "global.h"
 #include "pixel_to_matrix.h"
 #include "unproject_onto_mesh.h"
+#include "crop_mesh.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
-	void image_onto_mesh(igl::viewer::Viewer &viewer, GLOBAL &global);
+	/*false when the projection could not be made, the stages after it must not run*/
+	bool image_onto_mesh(igl::viewer::Viewer &viewer, GLOBAL &global);
+	/*Tiled mode of image_onto_mesh: fills global.projection instead of the hit arrays*/
+	bool project_tiles(igl::viewer::Viewer &viewer, GLOBAL &global, int size, const Eigen::Vector2f &center);
 }
 #endif // !IMAGE_ONTO_MESH_H_
@@ -0,0 +1,41 @@
+#include "job.h"
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#include <cerrno>
+
+namespace {
+	/*Every missing folder along path, an existing one is fine*/
+	bool make_dirs(const std::string &path)
+	{
+		for (std::size_t i = 1; i <= path.size(); i++) {
+			if (i < path.size() && path[i] != '/' && path[i] != '\\') continue;
+
+			std::string prefix = path.substr(0, i);
+			if (prefix.empty() || prefix.back() == ':') continue;
+#ifdef _WIN32
+			int failed = _mkdir(prefix.c_str());
+#else
+			int failed = mkdir(prefix.c_str(), 0755);
+#endif
+			if (failed && errno != EEXIST) return false;
+		}
+		return true;
+	}
+}
+
+std::string qrcode::JobContext::path(const std::string & name) const
+{
+	if (output_dir.empty()) return name;
+
+	char last = output_dir.back();
+	return (last == '/' || last == '\\') ? output_dir + name : output_dir + "/" + name;
+}
+
+bool qrcode::JobContext::prepare() const
+{
+	return make_dirs(path("Optimization"));
+}
@@ -0,0 +1,45 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef JOB_H_
+#define JOB_H_
+#include <string>
+#include <Eigen/dense>
+namespace qrcode {
+
+	/*Carved model handed from directional_light to reflaction*/
+	struct ReflactionInput
+	{
+		bool ready;
+		int qr_size, scale, border;
+		Eigen::MatrixXi black_module_seg;//(y, x, length) rows
+		Eigen::MatrixXi modules;//lower modules
+		Eigen::MatrixXd qr_verticals, verticles;
+		Eigen::MatrixXi facets;
+
+		ReflactionInput() :ready(false), qr_size(0), scale(0), border(0) {}
+	};
+
+	/*
+	What one job owns besides its GLOBAL: where its files go and what its stages hand
+	each other. Nothing here is process wide, so jobs with their own GLOBAL can run
+	side by side on the shared task pool.
+	*/
+	struct JobContext
+	{
+		std::string output_dir;//empty for the working directory
+		ReflactionInput reflaction;
+
+		/*output_dir joined with name*/
+		std::string path(const std::string &name) const;
+		/*Creates output_dir and its Optimization folder*/
+		bool prepare() const;
+	};
+}
+
+#endif // !JOB_H_
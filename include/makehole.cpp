@@ -2,6 +2,7 @@
 
 void qrcode::make_hole(GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::make_hole");
 
 	/*Dividing a model facet set into a rest set and many hole sets*/
 	std::vector<std::vector<int>::iterator> iter;
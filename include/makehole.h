@@ -12,6 +12,7 @@
 #include <algorithm>
 #include "global.h"
 #include "halfedge.h"
+#include "trace.h"
 namespace qrcode{
 
 	/*
@@ -0,0 +1,114 @@
+#include "mapped_file.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+qrcode::MappedFile::MappedFile() : base(nullptr), bytes(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+{
+}
+#else
+qrcode::MappedFile::MappedFile() : base(nullptr), bytes(0), file(-1)
+{
+}
+#endif
+
+qrcode::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool qrcode::MappedFile::create(const std::string & path, std::size_t bytes, bool temporary)
+{
+	close();
+	if (bytes == 0) return false;
+
+#ifdef _WIN32
+	const DWORD flags = temporary ? FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE : FILE_ATTRIBUTE_NORMAL;
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, temporary ? FILE_SHARE_DELETE : 0, nullptr, CREATE_ALWAYS, flags, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	const unsigned long long size = bytes;
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xffffffffULL), nullptr);
+	if (mapping != nullptr)
+		base = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+#else
+	file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) return false;
+
+	if (ftruncate(file, static_cast<off_t>(bytes)) == 0) {
+		void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		if (p != MAP_FAILED) base = static_cast<char *>(p);
+	}
+	/*The mapping keeps the pages alive, the name is not needed any more*/
+	if (temporary) ::unlink(path.c_str());
+#endif
+
+	if (base == nullptr) {
+		close();
+		return false;
+	}
+	this->bytes = bytes;
+	return true;
+}
+
+bool qrcode::MappedFile::open(const std::string & path)
+{
+	close();
+	std::size_t size = 0;
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+		size = static_cast<std::size_t>(length.QuadPart);
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+			base = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		size = static_cast<std::size_t>(status.st_size);
+		void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (p != MAP_FAILED) base = static_cast<char *>(p);
+	}
+#endif
+
+	if (base == nullptr) {
+		close();
+		return false;
+	}
+	this->bytes = size;
+	return true;
+}
+
+void qrcode::MappedFile::close()
+{
+#ifdef _WIN32
+	if (base != nullptr) UnmapViewOfFile(base);
+	if (mapping != nullptr) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (base != nullptr) munmap(base, bytes);
+	if (file >= 0) ::close(file);
+	file = -1;
+#endif
+	base = nullptr;
+	bytes = 0;
+}
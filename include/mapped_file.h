@@ -0,0 +1,46 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+#include <cstddef>
+#include <string>
+namespace qrcode {
+
+	/*Read/write mapping of a whole file, the OS pages it in and out on demand*/
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		/*Creates or truncates path to bytes and maps it; a temporary file is removed once it is no longer mapped*/
+		bool create(const std::string &path, std::size_t bytes, bool temporary = false);
+		/*Maps an existing, non empty file read only; data() must not be written*/
+		bool open(const std::string &path);
+		void close();
+
+		bool is_open() const { return base != nullptr; }
+		char *data() const { return base; }
+		std::size_t size() const { return bytes; }
+
+	private:
+		MappedFile(const MappedFile &);
+		MappedFile &operator=(const MappedFile &);
+
+		char *base;
+		std::size_t bytes;
+#ifdef _WIN32
+		void *file, *mapping;
+#else
+		int file;
+#endif
+	};
+}
+
+#endif // !MAPPED_FILE_H_
@@ -0,0 +1,78 @@
+#include "memory_budget.h"
+
+namespace {
+	const double MB = 1024.0*1024.0;
+}
+
+std::string qrcode::MemoryEstimate::report() const
+{
+	std::ostringstream out;
+	out.precision(1);
+	out << std::fixed << "projection " << projection / MB << " MB, control " << control / MB << " MB, qr mesh " << qr_mesh / MB
+		<< " MB, carving " << carving / MB << " MB, peak " << peak / MB << " MB";
+	return out.str();
+}
+
+void qrcode::estimate_memory(const GLOBAL & global, MemoryEstimate & estimate)
+{
+	const std::size_t scale = global.info.scale;
+	const std::size_t side = (global.info.pixels.size() + 2 * global.info.border)*scale;
+	const std::size_t corners = (side + 1)*(side + 1);
+	const std::size_t margin = (side + 2 * scale + 1)*(side + 2 * scale + 1);
+	const std::size_t cells = side*side;
+
+	/*image_onto_mesh: one hit per pixel of the widened grid and three rows per corner*/
+	estimate.projection = margin*sizeof(igl::Hit) + corners * 3 * (2 * sizeof(float) + sizeof(double));
+
+	/*Tiled: the mapping pages in about one band of tiles at a time*/
+	if (global.tiled_projection)
+		estimate.projection = (side + 2 * scale + 1)*ProjectionStore::tile*sizeof(ProjectionStore::Point);
+
+	/*Strategy and qr_mesh: control mask, cell index per pixel, back map and four links per cell*/
+	estimate.control = margin*sizeof(int) + cells*sizeof(Eigen::Vector2i) + side*sizeof(std::vector<Eigen::Vector2i>)
+		+ cells*(sizeof(Eigen::Vector2i) + sizeof(Eigen::Vector4i));
+
+	/*Four corners per cell, two own facets plus up to two links to the right and below*/
+	const std::size_t qr_vertices = 4 * cells;
+	const std::size_t qr_facets = 6 * cells;
+	estimate.qr_mesh = qr_vertices*(3 * sizeof(double) + sizeof(double)) + qr_facets*(3 * sizeof(int) + 3 * sizeof(double));
+
+	/*directional_light: merged double and float copies of the mesh, two BVHs, ~64 bytes per triangle each,
+	the carved grid in the depth solver and the position, normal, AO and gray buffers per cell*/
+	const std::size_t vertices = qr_vertices + global.model_vertices.rows();
+	const std::size_t facets = qr_facets + global.model_facets.rows();
+	estimate.carving = vertices*3 * (sizeof(double) + sizeof(float)) + facets*(3 * sizeof(int) + 2 * 64)
+		+ qr_vertices * 3 * sizeof(double) + cells*(6 * sizeof(float) + 4 * sizeof(int));
+
+	/*projection and control stay alive in GLOBAL, the rest adds up during carving*/
+	estimate.peak = estimate.projection + estimate.control + estimate.qr_mesh + estimate.carving;
+}
+
+bool qrcode::memory_check(const GLOBAL & global, const std::string & stage)
+{
+	MemoryEstimate estimate;
+	qrcode::estimate_memory(global, estimate);
+	std::cout << stage << " memory: " << estimate.report() << std::endl;
+
+	if (global.memory_limit > 0 && estimate.peak > global.memory_limit*MB) {
+		std::cout << stage << " refused: peak above the " << global.memory_limit << " MB limit, lower the scale or the version" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void qrcode::release_intermediates(GLOBAL & global, MemoryStage stage)
+{
+	if (global.memory_limit <= 0) return;
+
+	/*swap with an empty object, clear() keeps the capacity*/
+	switch (stage) {
+	case MemoryStage::Projected:
+		/*Ray origins are written by the projection and never read again*/
+		Eigen::MatrixXf().swap(global.source);
+		break;
+	case MemoryStage::HolesFound:
+		std::vector<igl::Hit>().swap(global.hitmap);
+		break;
+	}
+}
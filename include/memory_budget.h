@@ -0,0 +1,54 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+#include <cstddef>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <Eigen/dense>
+#include <igl/Hit.h>
+#include "global.h"
+namespace qrcode {
+
+	/*Projected bytes of the grid sized data, worst case: every cell under control*/
+	struct MemoryEstimate
+	{
+		std::size_t projection;//hitmap, source, direct, hit_matrix, or the resident band of the tile store
+		std::size_t control;//under_control, indicator, anti_indicatior, patch_indicator
+		std::size_t qr_mesh;//qr_verticals, qr_facets, qr_colors, carve_depth
+		std::size_t carving;//merged mesh, both BVHs and the per cell buffers of directional_light
+		std::size_t peak;//largest set alive at once
+
+		std::string report() const;
+	};
+
+	enum class MemoryStage
+	{
+		Projected,//image_onto_mesh is done
+		HolesFound,//find_hole is done, nothing reads the hitmap any more
+	};
+
+	//************************************
+	// Method:    qrcode::estimate_memory
+	//
+	// Sizes follow from the QR grid side (pixels+2*border)*scale+1 and the model, so
+	// this can run as soon as the QR code and the mesh are loaded.
+	//************************************
+	void estimate_memory(const GLOBAL &global, MemoryEstimate &estimate);
+
+	/*Prints the estimate; false when global.memory_limit is set and the peak is above it*/
+	bool memory_check(const GLOBAL &global, const std::string &stage);
+
+	/*In budget mode, frees the arrays whose last consumer finished at stage*/
+	void release_intermediates(GLOBAL &global, MemoryStage stage);
+}
+
+#endif // !MEMORY_BUDGET_H_
@@ -2,8 +2,9 @@
 typedef qrgen::Pixel::PixelRole PR;
 std::vector<Eigen::MatrixXi> qrcode::module_adapter(Engine * engine, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::module_adapter");
 	/*Origin modules*/
-	auto pixels = global.info.pixels;
+	auto &pixels = global.info.pixels;
 
 	int border = global.info.border; 
 
@@ -11,7 +12,7 @@ std::vector<Eigen::MatrixXi> qrcode::module_adapter(Engine * engine, GLOBAL & gl
 
 	int scale = global.info.scale;
 
-	Eigen::MatrixXi controller = global.under_control.block(scale,scale, size*scale, size*scale);
+	const auto controller = global.under_control.block(scale,scale, size*scale, size*scale);
 
 	Eigen::MatrixXi modules; 
 
@@ -23,279 +24,132 @@ std::vector<Eigen::MatrixXi> qrcode::module_adapter(Engine * engine, GLOBAL & gl
 		}
 	}
 
-	qrcode::write_png("qrcode_origin.png", modules,scale);
+	qrcode::write_png(global.job.path("qrcode_origin.png"), modules,scale);
 
 	/*Decrease long adjacent region to upper_modules*/
 
 	Eigen::MatrixXi upper_modules = modules;
 	Eigen::MatrixXi region = upper_modules.block(border, border, global.info.pixels.size(), global.info.pixels.size());
 
-
-	Eigen::MatrixXi label;
-	qrcode::bwlabel(engine, region, 4, label);
-
-	Eigen::MatrixXi t = label; 
-	label.setZero(label.rows(), label.cols() + 1);
-	label.block(0, 0, label.rows(), label.rows()) = t; 
-
+	/*Horizontal black runs of the code*/
 	std::vector<Eigen::Vector3i> segments;
-	for (int y = 0; y < label.rows(); y++) {
-		int count = 0;
-		int temp = 0;
-		Eigen::Vector2i index;
-
-		for (int x = 0; x < label.cols(); x++) {
-
-			if (label(y, x) != temp&&label(y, x) == 0) {
-				temp = 0;
-				segments.emplace_back(index(0), index(1), count);
-				continue;
-			}
-			 
-			if (label(y, x) != temp&&label(y, x) != 0) {
-				temp = label(y, x);
-				index << y, x;
-				count = 1;
-				continue;
-			}
-			if (label(y, x) == temp&&label(y, x) != 0) {
-				count++;
-			}
-
-		}
-	}
+	qrcode::BitGrid(region).runs(segments);
 
-	std:sort(segments.begin(), segments.end(), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
+	/*Longest run first; ties by position so the order does not depend on the heap*/
+	const auto shorter = [](const Eigen::Vector3i &a, const Eigen::Vector3i &b) {
+		if (a(2) != b(2)) return a(2) < b(2);
+		if (a(0) != b(0)) return a(0) > b(0);
+		return a(1) > b(1);
+	};
+	std::priority_queue<Eigen::Vector3i, std::vector<Eigen::Vector3i>, decltype(shorter)> queue(shorter, segments);
 
-	int down_size = 3;
-	int length = 177,index=0;
-
-	bool stop_iter = false;
+	/*Blocks that can still afford a changed codeword*/
+	int open_blocks = 0;
+	for (int i = 0; i < global.info.block_propertys.size(); i++)
+		if (global.info.block_propertys[i] > 0) open_blocks++;
 
 	Eigen::MatrixXi modefier;
 	modefier.setOnes(upper_modules.rows(), upper_modules.cols());
 
+	const auto editable = [&pixels](int y, int x) {
+		PR role = pixels[y][x].getPixelRole();
+		return role == PR::DATA || role == PR::CHECK || role == PR::EXTRA;
+	};
 
-	while (!stop_iter) {
+	/*Whiten column c of a run if its codeword is already changed or its block has budget left, then requeue the part right of it*/
+	const auto whiten = [&](const Eigen::Vector3i &seg, int c) {
+		qrgen::Pixel pixel = pixels[seg(0)][seg(1) + c];
+		auto &codeword = global.info.codewodrs[pixel.getOffset() / 8];
 
-		length = segments[index](2);
-		if (length <= 3) {
-			break;
-		}
-		else {
-			int dx;
-			if (length >= 6)
-				dx = 3;
-			else
-				dx = length / 2;
+		if (!codeword.getStatus()) {
+			int &budget = global.info.block_propertys[pixel.getBlockIndex()];
+			if (budget <= 0) return;
 
-			qrgen::Pixel pixel = pixels[segments[index](0)][segments[index](1) + dx];
-
-			if (!(pixel.getPixelRole() ==PR::DATA || pixel.getPixelRole() == PR::CHECK || pixel.getPixelRole() == PR::EXTRA)) {
-
-				pixel = pixels[segments[index](0)][segments[index](1) + dx-1];
-
-				if (pixel.getPixelRole() == PR::DATA || pixel.getPixelRole() == PR::CHECK || pixel.getPixelRole() == PR::EXTRA) {
-
-					if (global.info.codewodrs[pixel.getOffset()/8].getStatus()) {
-
-						upper_modules(segments[index](0) + border, segments[index](1) + dx-1 + border) = 0;
-						modefier(segments[index](0) + border, segments[index](1) + dx - 1 + border) = 0;
-
-						if (length - dx > 3) {
-							auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - 3), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-							segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + dx, length - dx));
-						}		
-					}
-					else if (global.info.block_propertys[pixel.getBlockIndex()] > 0) {
-
-						global.info.codewodrs[pixel.getOffset()/8].setTrue();
-						upper_modules(segments[index](0) + border, segments[index](1) + dx-1 + border) = 0;
-						modefier(segments[index](0) + border, segments[index](1) + dx - 1 + border) = 0;
-						global.info.block_propertys[pixel.getBlockIndex()] -= 1;
-
-						if (length - 3 > 3) {
-							auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - 3), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-							segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + 3, length - 3));
-						}
-					}
-				}
-				else {
-					for (dx = dx + 1; dx <= length; dx++) {
-
-						pixel = pixels[segments[index](0)][segments[index](1) + dx];
-
-						if (pixel.getPixelRole() == PR::DATA || pixel.getPixelRole() == PR::CHECK || pixel.getPixelRole() == PR::EXTRA) {
-
-							if (global.info.codewodrs[pixel.getOffset()/8].getStatus()) {
+			codeword.setTrue();
+			if (--budget == 0) open_blocks--;
+		}
 
-								upper_modules(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-								modefier(segments[index](0) + border, segments[index](1) + dx + border) = 0;
+		upper_modules(seg(0) + border, seg(1) + c + border) = 0;
+		modefier(seg(0) + border, seg(1) + c + border) = 0;
 
-								if (length - dx-1 > 3) {
-									auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - dx - 1), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-									segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + dx + 1, length - dx - 1));
-								}
-							}
-							else if (global.info.block_propertys[pixel.getBlockIndex()] > 0) {
+		if (seg(2) - c - 1 > 3) queue.push(Eigen::Vector3i(seg(0), seg(1) + c + 1, seg(2) - c - 1));
+	};
 
-								global.info.codewodrs[pixel.getOffset()/8].setTrue();
-								upper_modules(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-								modefier(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-								
-								global.info.block_propertys[pixel.getBlockIndex()] -= 1;
+	while (open_blocks > 0 && !queue.empty() && queue.top()(2) > 3) {
+		Eigen::Vector3i seg = queue.top();
+		queue.pop();
 
-								if (length - dx - 1 > 3) {
-									auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - dx - 1), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-									segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + dx + 1, length - dx - 1));
-								}
-							}
-							break;
-						}
-					}
-				}
+		const int length = seg(2);
+		int dx = length >= 6 ? 3 : length / 2;
 
-			}
-			else {
-				pixel = pixels[segments[index](0)][segments[index](1) + dx];
-
-				if (pixel.getPixelRole() == PR::DATA || pixel.getPixelRole() == PR::CHECK || pixel.getPixelRole() == PR::EXTRA) {
-
-					if (global.info.codewodrs[pixel.getOffset()/8].getStatus()) {
-
-						upper_modules(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-						modefier(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-						
-						if (length - dx - 1 > 3) {
-							auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - dx - 1), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-							segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + dx + 1, length - dx - 1));
-						}
-					}
-					else if (global.info.block_propertys[pixel.getBlockIndex()] > 0) {
-
-						global.info.codewodrs[pixel.getOffset()/8].setTrue();
-						upper_modules(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-						modefier(segments[index](0) + border, segments[index](1) + dx + border) = 0;
-
-						if (length - dx - 1 > 3) {
-							auto pos = std::lower_bound(segments.begin(), segments.end(), Eigen::Vector3i(0, 0, length - dx - 1), [](Eigen::Vector3i seg1, Eigen::Vector3i seg2) {return seg1(2) > seg2(2); });
-							segments.insert(pos, Eigen::Vector3i(segments[index](0), segments[index](1) + dx + 1, length - dx - 1));
-						}
-					}
-				}
-			}
-		}
-
-		bool all_use = true;
-		for (int i = 0; i < global.info.block_propertys.size();i++) {
-			if (global.info.block_propertys[i] > 0) all_use &= false;
+		/*Cut the run after its third module, or as close behind it as an editable module allows*/
+		if (!editable(seg(0), seg(1) + dx)) {
+			if (editable(seg(0), seg(1) + dx - 1))
+				dx--;
+			else
+				for (dx++; dx < length && !editable(seg(0), seg(1) + dx); dx++);
 		}
-		stop_iter |= all_use;
 
-		index++;
+		if (dx < length) whiten(seg, dx);
 	}
 
-	qrcode::write_png("qrcode_opt.png", modules, upper_modules, scale);
-	qrcode::write_png("qrcode_upper.png", upper_modules, scale);
+	qrcode::write_png(global.job.path("qrcode_opt.png"), modules, upper_modules, scale);
+	qrcode::write_png(global.job.path("qrcode_upper.png"), upper_modules, scale);
 
 	/*Increase black modules to lower modules*/
 
 	int version = (pixels.size() - 17) / 4;
 	int remainder = global.info.num_of_check_byte/2 - global.info.block_propertys[0]+4;
 
+	/*White modules whose horizontal neighbours are white and were not whitened above*/
+	qrcode::BitGrid upper_bits(upper_modules), kept(modefier);
+	qrcode::BitGrid candidate = ~upper_bits & ~upper_bits.shifted(1) & ~upper_bits.shifted(-1) & kept.shifted(1) & kept.shifted(-1);
+
 	Eigen::MatrixXi lower_modules;
 	lower_modules.setZero(modules.rows(), modules.cols());
-	for (int y = 0; y < pixels.size(); y++) {
-		for (int x = 0; x < pixels.size(); x++) {
-			if (upper_modules(y + border, x + border) == 0 && upper_modules(y + border, x + border + 1) == 0 && upper_modules(y + border, x + border - 1) == 0) {
-				if (lower_modules(y + border, x + border + 1) == 0 && lower_modules(y + border, x + border - 1) == 0 && modefier(y + border, x + border + 1) == 1 && modefier(y + border, x + border - 1) == 1) {
-					if (pixels[y][x].getPixelRole() == PR::DATA || pixels[y][x].getPixelRole() == PR::CHECK || pixels[y][x].getPixelRole() == PR::EXTRA) {
-						if (pixels[y][x].getBlockIndex() == 0 && global.info.codewodrs[pixels[y][x].getOffset() / 8].getStatus() == false) {
-							lower_modules(y + border, x + border) = 1;
-							remainder--;
-							global.info.codewodrs[pixels[y][x].getOffset() / 8].setTrue();
-							if (remainder <= 0)
-								break;
-						}
-					}
-
-				}
+	for (int y = 0; y < pixels.size() && remainder > 0; y++) {
+		const int end = border + pixels.size();
+
+		for (int X = candidate.next_set(y + border, border); X < end; X = candidate.next_set(y + border, X + 1)) {
+			int x = X - border;
+
+			/*Rows are filled from the left, so only the left neighbour can already be lower*/
+			if (lower_modules(y + border, X - 1) != 0) continue;
+			if (!(pixels[y][x].getPixelRole() == PR::DATA || pixels[y][x].getPixelRole() == PR::CHECK || pixels[y][x].getPixelRole() == PR::EXTRA)) continue;
+
+			if (pixels[y][x].getBlockIndex() == 0 && global.info.codewodrs[pixels[y][x].getOffset() / 8].getStatus() == false) {
+				lower_modules(y + border, X) = 1;
+				remainder--;
+				global.info.codewodrs[pixels[y][x].getOffset() / 8].setTrue();
+				if (remainder <= 0)
+					break;
 			}
-
 		}
-		if (remainder <= 0)
-			break;
 	}
 	
-	qrcode::write_png1("qrcode_lower_append.png", upper_modules, lower_modules, scale);
+	qrcode::write_png1(global.job.path("qrcode_lower_append.png"), upper_modules, lower_modules, scale);
 
 	/*Find adjacent black modules*/
 	Eigen::MatrixXi both_modules = upper_modules + lower_modules;
 
-	qrcode::write_png("qrcode_lower.png",both_modules,scale);
+	qrcode::write_png(global.job.path("qrcode_lower.png"),both_modules,scale);
 
 	
 
 	region = both_modules.block(border, border, global.info.pixels.size(), global.info.pixels.size());
+	qrcode::BitGrid(region).runs(global.black_module_segments);
 
-	qrcode::bwlabel(engine, region, 4, label);
-
-	Eigen::MatrixXi tmp = label;
-
-	label.setZero(label.rows(), label.cols() + 1);
-	
-	label.block(0, 0, label.rows(), label.cols()-1) = tmp;
-	std::cout << label << std::endl;
-
-	global.black_module_segments.clear();
-
-	for (int y = 0; y < label.rows(); y++) {
-		int count = 0;
-		int temp = 0;
-		Eigen::Vector2i index;
-
-		for (int x = 0; x < label.cols(); x++) {
-
-			if (label(y, x) != temp && label(y, x) == 0) {
-				temp = 0;
-				global.black_module_segments.emplace_back(index(0), index(1), count);
-				continue;
-			}
-
-			if (label(y, x) != temp&&label(y, x) != 0) {
-				temp = label(y, x);
-				index << y, x;
-				count = 1;
-				continue;
-			}
-			if (label(y, x) == temp&&label(y, x) != 0) {
-				count++;
-			}
-
-		}
-	}
-	Eigen::MatrixXi black_module_seg(global.black_module_segments.size(), 3);
-	for (int i = 0; i < global.black_module_segments.size(); i++) black_module_seg.row(i) = global.black_module_segments[i].transpose();
-
-
-	std::string binary_file = "reflaction";
-	igl::serialize(black_module_seg, "black_module_seg", binary_file, true);
-
-	for (auto s : global.black_module_segments) std::cout << s.transpose() << std::endl;
 	Eigen::MatrixXi upper_Modules, lower_Modules;
 
 	upper_Modules.setZero(controller.rows() + 1, controller.cols() + 1);
 	lower_Modules.setZero(controller.rows() + 1, controller.cols() + 1);
 
-	for (int y = 0; y < modules.rows(); y++) {
-		for (int x = 0; x < modules.cols(); x++) {
-			for (int u = 0; u < scale; u++) {
-				for (int v = 0; v < scale; v++) {
-					upper_Modules(y*scale + u, x*scale + v) = upper_modules(y, x);
-					lower_Modules(y*scale + u, x*scale + v) = lower_modules(y, x);
-				}	
-			}	
-		}	
-	}	
+	/*Each module becomes a scale x scale block*/
+	Eigen::MatrixXi up;
+	qrcode::BitGrid(upper_modules).upsample(scale).to_matrix(up);
+	upper_Modules.block(0, 0, up.rows(), up.cols()) = up;
+
+	qrcode::BitGrid(lower_modules).upsample(scale).to_matrix(up);
+	lower_Modules.block(0, 0, up.rows(), up.cols()) = up;
 	return{ upper_Modules,lower_Modules};
 }
@@ -8,12 +8,16 @@
 
 #ifndef MODULE_ADAPTER_H_
 #define MODULE_ADAPTER_H_
+#include <vector>
+#include <queue>
 #include <algorithm>
 #include <Eigen/dense>
 #include <igl/serialize.h>
 #include "global.h"
 #include "bwlabel.h"
+#include "bitgrid.h"
 #include "writePNG.h"
+#include "trace.h"
 namespace qrcode {
 	std::vector<Eigen::MatrixXi> module_adapter(Engine * engine, GLOBAL &global);
 }
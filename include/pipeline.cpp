@@ -0,0 +1,132 @@
+#include "pipeline.h"
+
+qrcode::Pipeline::Pipeline() :clock(0)
+{
+}
+
+void qrcode::Pipeline::stage(const std::string & name, const std::vector<std::string>& inputs, const std::vector<std::string>& outputs, const Run & run)
+{
+	int index = 0;
+	while (index < stages.size() && stages[index].name != name) index++;
+
+	for (int i = 0; i < inputs.size(); i++) {
+		auto it = producer.find(inputs[i]);
+		if (it != producer.end() && it->second >= index)
+			throw std::logic_error("Pipeline stage " + name + " reads " + inputs[i] + " before it is produced");
+	}
+	for (int i = 0; i < outputs.size(); i++) {
+		auto it = producer.find(outputs[i]);
+		if (it != producer.end() && it->second != index)
+			throw std::logic_error("Pipeline output " + outputs[i] + " has two stages");
+	}
+
+	if (index == stages.size()) {
+		Stage fresh;
+		fresh.name = name;
+		fresh.done = false;
+		stages.push_back(fresh);
+	}
+
+	Stage &s = stages[index];
+	if (s.inputs != inputs || s.outputs != outputs) s.done = false;
+	s.inputs = inputs;
+	s.outputs = outputs;
+	s.run = run;
+
+	for (int i = 0; i < outputs.size(); i++) producer[outputs[i]] = index;
+}
+
+void qrcode::Pipeline::param(const std::string & name, const std::vector<double>& values)
+{
+	auto it = params.find(name);
+	if (it != params.end() && it->second == values) return;
+
+	params[name] = values;
+	touch(name);
+}
+
+void qrcode::Pipeline::param_text(const std::string & name, const std::string & text)
+{
+	auto it = texts.find(name);
+	if (it != texts.end() && it->second == text) return;
+
+	texts[name] = text;
+	touch(name);
+}
+
+void qrcode::Pipeline::touch(const std::string & name)
+{
+	version[name] = ++clock;
+}
+
+bool qrcode::Pipeline::run(const std::vector<std::string>& outputs)
+{
+	/*Walk back from the requested outputs to every stage they need*/
+	std::vector<bool> needed(stages.size(), false);
+	std::vector<std::string> open(outputs);
+
+	while (!open.empty()) {
+		std::string name = open.back();
+		open.pop_back();
+
+		auto it = producer.find(name);
+		if (it == producer.end() || needed[it->second]) continue;
+
+		needed[it->second] = true;
+		const Stage &s = stages[it->second];
+		open.insert(open.end(), s.inputs.begin(), s.inputs.end());
+	}
+
+	for (int i = 0; i < stages.size(); i++) {
+		Stage &s = stages[i];
+		if (!needed[i]) continue;
+
+		if (!dirty(s)) {
+			std::cout << "Stage " << s.name << " up to date" << std::endl;
+			continue;
+		}
+
+		/*A stage that throws or fails half way has to run again*/
+		s.done = false;
+		if (!s.run()) return false;
+
+		s.seen.resize(s.inputs.size());
+		for (int k = 0; k < s.inputs.size(); k++) s.seen[k] = version_of(s.inputs[k]);
+		s.done = true;
+
+		for (int k = 0; k < s.outputs.size(); k++) touch(s.outputs[k]);
+	}
+	return true;
+}
+
+bool qrcode::Pipeline::dirty(const std::string & stage) const
+{
+	for (int i = 0; i < stages.size(); i++)
+		if (stages[i].name == stage) return dirty(stages[i]);
+	return true;
+}
+
+void qrcode::Pipeline::clear()
+{
+	stages.clear();
+	producer.clear();
+	version.clear();
+	params.clear();
+	texts.clear();
+	values.clear();
+}
+
+bool qrcode::Pipeline::dirty(const Stage & stage) const
+{
+	if (!stage.done || stage.seen.size() != stage.inputs.size()) return true;
+
+	for (int k = 0; k < stage.inputs.size(); k++)
+		if (stage.seen[k] != version_of(stage.inputs[k])) return true;
+	return false;
+}
+
+unsigned long long qrcode::Pipeline::version_of(const std::string & name) const
+{
+	auto it = version.find(name);
+	return it == version.end() ? 0 : it->second;
+}
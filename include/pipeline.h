@@ -0,0 +1,82 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <iostream>
+namespace qrcode {
+
+	/*
+	Stages with declared inputs and outputs, run lazily. Every resource (a parameter
+	or a stage output) carries a version; a stage is dirty when it never succeeded or
+	an input version moved since its last run, and a successful run moves its outputs,
+	which dirties everything downstream. Stages are declared in dependency order and
+	may be declared again on every call: the run functions are replaced while the
+	versions and the values they produced are kept.
+	*/
+	class Pipeline
+	{
+	public:
+		/*false stops the run and leaves the stage dirty*/
+		typedef std::function<bool()> Run;
+
+		Pipeline();
+
+		/*Inputs are parameters or outputs of stages declared before*/
+		void stage(const std::string &name, const std::vector<std::string> &inputs, const std::vector<std::string> &outputs, const Run &run);
+		/*Moves the parameter only when values differ from the last call; doubles keep any int exactly*/
+		void param(const std::string &name, const std::vector<double> &values);
+		/*Same for a text value, e.g. a folder*/
+		void param_text(const std::string &name, const std::string &text);
+		/*Marks a resource changed from outside, e.g. a new projection*/
+		void touch(const std::string &name);
+		/*Runs the dirty stages the outputs depend on, in declaration order*/
+		bool run(const std::vector<std::string> &outputs);
+		bool dirty(const std::string &stage) const;
+		/*Forgets every version and value*/
+		void clear();
+
+		/*Storage for stage results, default constructed on first use*/
+		template<class T>
+		T &value(const std::string &name)
+		{
+			std::shared_ptr<void> &slot = values[name];
+			if (!slot) slot = std::make_shared<T>();
+			return *static_cast<T *>(slot.get());
+		}
+
+	private:
+		struct Stage
+		{
+			std::string name;
+			std::vector<std::string> inputs, outputs;
+			Run run;
+			std::vector<unsigned long long> seen;//input versions of the last successful run
+			bool done;
+		};
+
+		bool dirty(const Stage &stage) const;
+		unsigned long long version_of(const std::string &name) const;
+
+		std::vector<Stage> stages;
+		std::map<std::string, int> producer;
+		std::map<std::string, unsigned long long> version;
+		std::map<std::string, std::vector<double>> params;
+		std::map<std::string, std::string> texts;
+		std::map<std::string, std::shared_ptr<void>> values;
+		unsigned long long clock;
+	};
+}
+
+#endif // !PIPELINE_H_
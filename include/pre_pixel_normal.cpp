@@ -2,6 +2,7 @@
 
 void qrcode::pre_pixel_normal(GLOBAL &global,Eigen::MatrixXd &qr_verticals, Eigen::MatrixXf &position, Eigen::MatrixXf &normal)
 {
+	QR_TRACE_SCOPE("qrcode::pre_pixel_normal");
 	int size = global.anti_indicatior.size();
 
 	position.resize(size, 3);
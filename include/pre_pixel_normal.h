@@ -12,6 +12,7 @@
 #include <vector>
 #include <Eigen/dense>
 #include "global.h"
+#include "trace.h"
 namespace qrcode {
 	
 	void pre_pixel_normal(GLOBAL &global, Eigen::MatrixXd &qr_verticales, Eigen::MatrixXf &position, Eigen::MatrixXf &normal);
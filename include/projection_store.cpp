@@ -0,0 +1,49 @@
+#include "projection_store.h"
+#include "global.h"
+
+qrcode::ProjectionStore::ProjectionStore() : n(0), m(0), per_side(0)
+{
+}
+
+bool qrcode::ProjectionStore::create(const std::string & file, int size, int margin)
+{
+	n = size;
+	m = margin;
+	per_side = (padded_size() + tile - 1) / tile;
+
+	std::size_t bytes = static_cast<std::size_t>(per_side)*per_side*tile*tile*sizeof(Point);
+	/*Scratch data only, removed with the mapping so it does not stay in the job folder*/
+	return storage.create(file, bytes, true);
+}
+
+void qrcode::ProjectionStore::close()
+{
+	storage.close();
+	n = m = per_side = 0;
+}
+
+Eigen::RowVector3d qrcode::projected_point(const GLOBAL & global, int index)
+{
+	if (!global.projection.is_open()) return global.hit_matrix.row(index);
+
+	const int size = global.projection.size();
+	const double *p = global.projection.at(index / size, index % size).point;
+	return Eigen::RowVector3d(p[0], p[1], p[2]);
+}
+
+Eigen::RowVector3f qrcode::projected_direct(const GLOBAL & global, int index)
+{
+	if (!global.projection.is_open()) return global.direct.row(index);
+
+	const int size = global.projection.size();
+	const float *d = global.projection.at(index / size, index % size).direct;
+	return Eigen::RowVector3f(d[0], d[1], d[2]);
+}
+
+const igl::Hit & qrcode::projected_hit(const GLOBAL & global, int index)
+{
+	if (!global.projection.is_open()) return global.hitmap[index];
+
+	const int side = global.projection.padded_size();
+	return global.projection.padded(index / side, index % side).hit;
+}
@@ -0,0 +1,85 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef PROJECTION_STORE_H_
+#define PROJECTION_STORE_H_
+#include <string>
+#include <algorithm>
+#include <Eigen/dense>
+#include <igl/Hit.h>
+#include "mapped_file.h"
+namespace qrcode {
+
+	struct GLOBAL;
+
+	/*
+	Out of core result of image_onto_mesh. The padded projection grid is cut into
+	64 x 64 tiles stored one after another in a mapped file, so a tile is one
+	contiguous block: projecting a tile touches only its own pages, and stages
+	that walk the grid row by row keep one band of tiles resident.
+	*/
+	class ProjectionStore
+	{
+	public:
+		static const int tile = 64;
+
+		struct Point
+		{
+			double point[3];//hit on the model, hit_matrix
+			float source[3];
+			float direct[3];
+			igl::Hit hit;//hitmap
+		};
+
+		ProjectionStore();
+
+		//************************************
+		// Method:    qrcode::ProjectionStore::create
+		//
+		// @param int size  grid corners per side, (pixels+2*border)*scale+1
+		// @param int margin  padding around the grid, only the hit is stored there
+		//
+		// The backing file is temporary, it is gone once the store is closed.
+		//************************************
+		bool create(const std::string &file, int size, int margin);
+		void close();
+		bool is_open() const { return storage.is_open(); }
+
+		int size() const { return n; }
+		int margin() const { return m; }
+		/*Side of the padded grid and its number of tiles per side*/
+		int padded_size() const { return n + 2 * m; }
+		int tiles() const { return per_side; }
+
+		/*Padded coordinates, 0 <= py, px < padded_size()*/
+		Point &padded(int py, int px) { return points()[offset(py, px)]; }
+		const Point &padded(int py, int px) const { return points()[offset(py, px)]; }
+		/*Grid corner (y, x), the row y*size()+x of hit_matrix and direct*/
+		Point &at(int y, int x) { return padded(y + m, x + m); }
+		const Point &at(int y, int x) const { return padded(y + m, x + m); }
+
+	private:
+		Point *points() const { return reinterpret_cast<Point *>(storage.data()); }
+		std::size_t offset(int py, int px) const
+		{
+			std::size_t t = static_cast<std::size_t>(py / tile)*per_side + px / tile;
+			return t*tile*tile + (py % tile)*tile + px % tile;
+		}
+
+		MappedFile storage;
+		int n, m, per_side;
+	};
+
+	/*Row index of hit_matrix / direct, read from the store when the projection is tiled*/
+	Eigen::RowVector3d projected_point(const GLOBAL &global, int index);
+	Eigen::RowVector3f projected_direct(const GLOBAL &global, int index);
+	/*Index of hitmap over the padded grid*/
+	const igl::Hit &projected_hit(const GLOBAL &global, int index);
+}
+
+#endif // !PROJECTION_STORE_H_
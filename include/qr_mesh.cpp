@@ -2,6 +2,7 @@
 
 void qrcode::generate_qr_mesh(Engine * engine, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::generate_qr_mesh");
 	int scale = global.info.scale;
 	int size = (2 * global.info.border + global.info.pixels.size())*scale + 1;
 
@@ -60,10 +61,10 @@ void qrcode::generate_qr_mesh(Engine * engine, GLOBAL & global)
 		int c = 4 * p + 2;
 		int d = 4 * p + 3;
 
-		V.row(a) << global.hit_matrix.row(y*size + x);
-		V.row(b) << global.hit_matrix.row((y + 1)*size + x);
-		V.row(c) << global.hit_matrix.row(y*size + x + 1) ;
-		V.row(d) << global.hit_matrix.row((y + 1)*size + x + 1);
+		V.row(a) << qrcode::projected_point(global, y*size + x);
+		V.row(b) << qrcode::projected_point(global, (y + 1)*size + x);
+		V.row(c) << qrcode::projected_point(global, y*size + x + 1) ;
+		V.row(d) << qrcode::projected_point(global, (y + 1)*size + x + 1);
 
 		F.row(2 * p) << a, b, c;
 		F.row(2 * p + 1) << b, d, c;
@@ -204,6 +205,7 @@ void qrcode::generate_qr_mesh(Engine * engine, GLOBAL & global)
 	for(int i=0;i<A.size();i++) FP.row(i) << A[i];
 
 	global.qr_verticals = V;
+	global.carve_direct.resize(0, 3);
 	global.qr_colors.setOnes(F.rows() + FP.rows(), 3);
 	global.qr_colors.block(0, 0, C.rows(), 3) = C;
 	global.qr_facets.resize(F.rows() + FP.rows(), 3);
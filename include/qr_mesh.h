@@ -15,6 +15,7 @@
 #include "global.h"
 #include "pixel_to_matrix.h"
 #include "bwlabel.h"
+#include "trace.h"
 namespace qrcode {
 	void generate_qr_mesh(Engine *engine, GLOBAL &global);
 }
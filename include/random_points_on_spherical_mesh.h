@@ -8,17 +8,28 @@
 
 #ifndef RANDOM_POINTS_ON_SPHERICAL_MESH_H_
 #define RANDOM_POINTS_ON_SPHERICAL_MESH_H_
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
 #include <Eigen/dense>
 #include <igl/PI.h>
-#include<igl/cumsum.h>
-#include "Histc.h"
-#include<igl/ray_mesh_intersect.h>
-#include<igl/random_points_on_mesh.h>
+#include "counter_rng.h"
+#include "alias_table.h"
 namespace qrcode {
-	void random_points_on_spherical_mesh(const Eigen::Vector3f&origin, const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets, int samples, Eigen::MatrixXf &result);
+	//************************************
+	// Method:    qrcode::random_points_on_spherical_mesh
+	//
+	// Uniform directions over the patch seen from origin. A spherical triangle is picked
+	// in proportion to its solid angle and a point is drawn inside it with Arvo's
+	// method, so every sample costs the same whatever the size of the patch.
+	//
+	// @param std::uint64_t seed  job seed, GLOBAL::seed
+	// @param std::uint64_t stream  random stream, give every caller its own (e.g. the cell index)
+	// @param Eigen::MatrixXf & result  samples x 3 unit directions
+	//************************************
+	void random_points_on_spherical_mesh(const Eigen::Vector3f&origin, const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets, int samples, std::uint64_t seed, std::uint64_t stream, Eigen::MatrixXf &result);
 	
 }
 
 #endif // !RANDOM_POINTS_ON_SPHERICAL_MESH_H_
-
-
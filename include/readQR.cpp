@@ -1,6 +1,7 @@
 #include "readQR.h"
 qrcode::QRinfo qrcode::readQR(Engine *engine,std::string & file_name)
 {
+	QR_TRACE_SCOPE("qrcode::readQR");
 
 	QRinfo qrinfo;
 	/*Analyze QR configuration*/
@@ -12,6 +12,7 @@
 #include "QRinfo.h"
 #include "VisualArea.h"
 #include "pixel_to_matrix.h"
+#include "trace.h"
 namespace qrcode {
 
 	qrcode::QRinfo readQR(Engine *engine,std::string &file_name);
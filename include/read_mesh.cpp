@@ -0,0 +1,452 @@
+#include "read_mesh.h"
+
+namespace {
+	inline bool blank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool digit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline const char *skip_blank(const char *p, const char *end)
+	{
+		while (p < end && blank(*p)) p++;
+		return p;
+	}
+
+	inline const char *skip_token(const char *p, const char *end)
+	{
+		while (p < end && !blank(*p)) p++;
+		return p;
+	}
+
+	double power10(int e)
+	{
+		static const double exact[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		return e <= 22 ? exact[e] : std::pow(10.0, e);
+	}
+
+	/*Decimal number without locale or allocation; inf, nan and hex floats go through strtod*/
+	const char *parse_double(const char *p, const char *end, double &value)
+	{
+		const char *start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+		std::uint64_t mantissa = 0;
+		int digits = 0, scale = 0;
+		bool any = false;
+
+		for (; p < end && digit(*p); p++, any = true) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) digits++;
+			}
+			else scale++;
+		}
+		if (p < end && *p == '.') {
+			for (p++; p < end && digit(*p); p++, any = true) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) digits++;
+					scale--;
+				}
+			}
+		}
+
+		if (!any) {
+			char buffer[64];
+			std::size_t n = std::min<std::size_t>(skip_token(start, end) - start, sizeof(buffer) - 1);
+			std::memcpy(buffer, start, n);
+			buffer[n] = 0;
+			char *stop = buffer;
+			value = std::strtod(buffer, &stop);
+			return stop == buffer ? nullptr : start + (stop - buffer);
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			const char *q = p + 1;
+			bool down = false;
+			if (q < end && (*q == '-' || *q == '+')) down = *q++ == '-';
+			if (q < end && digit(*q)) {
+				int e = 0;
+				for (; q < end && digit(*q); q++) if (e < 10000) e = e * 10 + (*q - '0');
+				scale += down ? -e : e;
+				p = q;
+			}
+		}
+
+		double v = static_cast<double>(mantissa);
+		if (scale > 0) v *= power10(scale);
+		else if (scale < 0) v /= power10(-scale);
+		value = negative ? -v : v;
+		return p;
+	}
+
+	/*OBJ index, the texture and normal parts after '/' are skipped*/
+	const char *parse_index(const char *p, const char *end, long long &value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+		if (p >= end || !digit(*p)) return nullptr;
+
+		long long v = 0;
+		for (; p < end && digit(*p); p++) v = v * 10 + (*p - '0');
+		value = negative ? -v : v;
+		return skip_token(p, end);
+	}
+
+	enum class Record { Other, Vertex, Face };
+
+	inline Record record(const char *&p, const char *end)
+	{
+		p = skip_blank(p, end);
+		if (end - p < 2 || !blank(p[1])) return Record::Other;
+		if (p[0] == 'v') return p += 2, Record::Vertex;
+		if (p[0] == 'f') return p += 2, Record::Face;
+		return Record::Other;
+	}
+
+	struct Chunk
+	{
+		const char *begin, *end;
+		long long verts, tris;//records in the chunk
+		long long v0, t0;//first output rows
+		bool ok;
+	};
+}
+
+bool qrcode::read_mesh(const std::string & file, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets)
+{
+	std::string extension = file.substr(file.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension == "obj") return qrcode::read_obj(file, verticles, facets);
+	if (extension == "ply") return qrcode::read_ply(file, verticles, facets);
+	return igl::read_triangle_mesh(file, verticles, facets);
+}
+
+bool qrcode::read_obj(const std::string & file, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets)
+{
+	QR_TRACE_SCOPE("qrcode::read_obj");
+	qrcode::MappedFile map;
+	if (!map.open(file)) return false;
+
+	const char *data = map.data();
+	const std::size_t size = map.size();
+
+	/*About a megabyte per chunk, a few chunks per thread at most*/
+	const int n = static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(size >> 20, 8 * qrcode::num_threads())));
+	std::vector<Chunk> chunk(n);
+
+	for (int i = 0; i < n; i++) {
+		const char *p = data + size*i / n;
+		if (i > 0) {
+			const char *line = static_cast<const char *>(std::memchr(p, '\n', data + size - p));
+			p = line ? line + 1 : data + size;
+		}
+		chunk[i].begin = p;
+		chunk[i].verts = chunk[i].tris = 0;
+		chunk[i].ok = true;
+	}
+	for (int i = 0; i < n; i++) chunk[i].end = i + 1 < n ? chunk[i + 1].begin : data + size;
+
+	const auto each_line = [](const Chunk &c, const std::function<void(const char *, const char *)> &f) {
+		for (const char *p = c.begin; p < c.end;) {
+			const char *line = static_cast<const char *>(std::memchr(p, '\n', c.end - p));
+			if (!line) line = c.end;
+			f(p, line);
+			p = line + 1;
+		}
+	};
+
+	/*Count*/
+	qrcode::parallel_for(n, [&](const int i) {
+		Chunk &c = chunk[i];
+		each_line(c, [&c](const char *p, const char *end) {
+			Record r = record(p, end);
+			if (r == Record::Vertex) c.verts++;
+			else if (r == Record::Face) {
+				int corners = 0;
+				for (p = skip_blank(p, end); p < end; p = skip_blank(skip_token(p, end), end)) corners++;
+				if (corners >= 3) c.tris += corners - 2;
+			}
+		});
+	}, 1);
+
+	long long verts = 0, tris = 0;
+	for (int i = 0; i < n; i++) {
+		chunk[i].v0 = verts;
+		chunk[i].t0 = tris;
+		verts += chunk[i].verts;
+		tris += chunk[i].tris;
+	}
+
+	verticles.resize(verts, 3);
+	facets.resize(tris, 3);
+
+	/*Parse into the rows counted above*/
+	qrcode::parallel_for(n, [&](const int i) {
+		Chunk &c = chunk[i];
+		long long v = c.v0, t = c.t0;
+
+		each_line(c, [&](const char *p, const char *end) {
+			if (!c.ok) return;
+			Record r = record(p, end);
+
+			if (r == Record::Vertex) {
+				for (int k = 0; k < 3; k++) {
+					double x = 0;
+					p = skip_blank(p, end);
+					const char *q = p < end ? parse_double(p, end, x) : nullptr;
+					if (!q) {
+						c.ok = false;
+						return;
+					}
+					verticles(v, k) = x;
+					p = q;
+				}
+				v++;
+			}
+			else if (r == Record::Face) {
+				long long first = -1, last = -1;
+				int corners = 0;
+
+				for (p = skip_blank(p, end); p < end; p = skip_blank(p, end), corners++) {
+					long long index = 0;
+					p = parse_index(p, end, index);
+					if (!p) {
+						c.ok = false;
+						return;
+					}
+					/*1 based, negative counts back from the vertices read so far*/
+					index = index < 0 ? v + index : index - 1;
+					if (index < 0 || index >= verts) {
+						c.ok = false;
+						return;
+					}
+
+					if (corners == 0) first = index;
+					else if (corners >= 2) {
+						facets.row(t++) << static_cast<int>(first), static_cast<int>(last), static_cast<int>(index);
+					}
+					last = index;
+				}
+			}
+		});
+	}, 1);
+
+	for (int i = 0; i < n; i++) {
+		if (!chunk[i].ok) {
+			std::cout << "Malformed OBJ record in " << file << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool qrcode::read_ply(const std::string & file, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets)
+{
+	QR_TRACE_SCOPE("qrcode::read_ply");
+	qrcode::MappedFile map;
+	if (!map.open(file)) return false;
+
+	const char *data = map.data();
+	const std::size_t size = map.size();
+
+	const char *header_end = nullptr;
+	for (const char *p = data; p + 10 <= data + size; p++) {
+		if (std::memcmp(p, "end_header", 10) == 0) {
+			const char *line = static_cast<const char *>(std::memchr(p, '\n', data + size - p));
+			header_end = line ? line + 1 : nullptr;
+			break;
+		}
+	}
+	if (!header_end) return false;
+
+	const auto type_size = [](const std::string &type)->int {
+		if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") return 1;
+		if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") return 2;
+		if (type == "int" || type == "uint" || type == "float" || type == "int32" || type == "uint32" || type == "float32") return 4;
+		if (type == "double" || type == "float64") return 8;
+		return 0;
+	};
+
+	/*Fixed size properties of an element and the one list a face element may hold*/
+	struct Element
+	{
+		std::string name;
+		long long count;
+		int stride;//bytes of the scalar properties
+		int xyz[3];
+		std::string xyz_type[3];
+		int list_at;//scalar bytes before the list, -1 without list
+		std::string count_type, index_type;
+		int lists;
+	};
+
+	std::vector<Element> elements;
+	bool binary = false;
+	std::istringstream header(std::string(data, header_end));
+	std::string line;
+
+	while (std::getline(header, line)) {
+		std::istringstream words(line);
+		std::string key;
+		words >> key;
+
+		if (key == "format") {
+			std::string format;
+			words >> format;
+			binary = format == "binary_little_endian";
+		}
+		else if (key == "element") {
+			Element e;
+			words >> e.name >> e.count;
+			e.stride = 0;
+			e.xyz[0] = e.xyz[1] = e.xyz[2] = -1;
+			e.list_at = -1;
+			e.lists = 0;
+			elements.push_back(e);
+		}
+		else if (key == "property" && !elements.empty()) {
+			Element &e = elements.back();
+			std::string type, name;
+			words >> type;
+
+			if (type == "list") {
+				words >> e.count_type >> e.index_type;
+				e.list_at = e.stride;
+				e.lists++;
+				continue;
+			}
+			words >> name;
+			int bytes = type_size(type);
+			if (bytes == 0) return false;
+
+			int axis = name == "x" ? 0 : name == "y" ? 1 : name == "z" ? 2 : -1;
+			if (axis >= 0) {
+				e.xyz[axis] = e.stride;
+				e.xyz_type[axis] = type;
+			}
+			e.stride += bytes;
+		}
+	}
+
+	/*Only the layout the fast path knows, the rest goes to libigl*/
+	int vertex = -1, face = -1;
+	for (int i = 0; i < elements.size(); i++) {
+		if (elements[i].name == "vertex") vertex = i;
+		if (elements[i].name == "face") face = i;
+	}
+
+	bool simple = binary && vertex == 0 && elements[0].lists == 0 && elements[0].xyz[0] >= 0 && elements[0].xyz[1] >= 0 && elements[0].xyz[2] >= 0;
+	if (face >= 0) simple = simple && face == 1 && elements[1].lists == 1 && type_size(elements[1].count_type) > 0 && type_size(elements[1].index_type) > 0;
+
+	if (!simple) return igl::read_triangle_mesh(file, verticles, facets);
+
+	const auto scalar = [](const char *p, const std::string &type)->double {
+		if (type == "float" || type == "float32") { float v; std::memcpy(&v, p, 4); return v; }
+		if (type == "double" || type == "float64") { double v; std::memcpy(&v, p, 8); return v; }
+		if (type == "char" || type == "int8") return *reinterpret_cast<const std::int8_t *>(p);
+		if (type == "uchar" || type == "uint8") return *reinterpret_cast<const std::uint8_t *>(p);
+		if (type == "short" || type == "int16") { std::int16_t v; std::memcpy(&v, p, 2); return v; }
+		if (type == "ushort" || type == "uint16") { std::uint16_t v; std::memcpy(&v, p, 2); return v; }
+		if (type == "int" || type == "int32") { std::int32_t v; std::memcpy(&v, p, 4); return v; }
+		std::uint32_t v; std::memcpy(&v, p, 4); return v;
+	};
+
+	const Element &ve = elements[0];
+	const char *p = header_end;
+	if (static_cast<std::size_t>(data + size - p) < static_cast<std::size_t>(ve.count)*ve.stride) return false;
+
+	verticles.resize(ve.count, 3);
+	const bool floats = ve.xyz_type[0] == "float" && ve.xyz_type[1] == "float" && ve.xyz_type[2] == "float";
+
+	qrcode::parallel_for(ve.count, [&](const long long i) {
+		const char *row = p + i*ve.stride;
+		for (int k = 0; k < 3; k++) {
+			if (floats) {
+				float v;
+				std::memcpy(&v, row + ve.xyz[k], 4);
+				verticles(i, k) = v;
+			}
+			else verticles(i, k) = scalar(row + ve.xyz[k], ve.xyz_type[k]);
+		}
+	}, 4096);
+	p += ve.count*ve.stride;
+
+	if (face < 0) {
+		facets.resize(0, 3);
+		return true;
+	}
+
+	const Element &fe = elements[1];
+	const int count_bytes = type_size(fe.count_type);
+	const int index_bytes = type_size(fe.index_type);
+	const int triangle = fe.stride + count_bytes + 3 * index_bytes;
+	const char *end = data + size;
+
+	const auto index_at = [&](const char *q)->long long { return static_cast<long long>(scalar(q, fe.index_type)); };
+
+	/*Where the faces must end: elements after them are fixed size, unless they hold lists too*/
+	const char *face_end = end;
+	for (int i = 2; i < elements.size() && face_end != nullptr; i++) {
+		std::size_t bytes = static_cast<std::size_t>(elements[i].count)*elements[i].stride;
+		if (elements[i].lists > 0 || static_cast<std::size_t>(face_end - p) < bytes) face_end = nullptr;
+		else face_end -= bytes;
+	}
+
+	/*Every list of three: fixed stride, checked and decoded in parallel. Only taken when the
+	stride lands exactly on face_end, so a polygon further on can not be read as triangles*/
+	bool triangles = face_end != nullptr && static_cast<std::size_t>(face_end - p) == static_cast<std::size_t>(fe.count)*triangle;
+	if (triangles) {
+		Eigen::MatrixXi F(fe.count, 3);
+		std::atomic<bool> ok(true);
+
+		qrcode::parallel_for(fe.count, [&](const long long i) {
+			const char *row = p + i*triangle;
+			if (scalar(row + fe.list_at, fe.count_type) != 3) {
+				ok = false;
+				return;
+			}
+			for (int k = 0; k < 3; k++) {
+				long long index = index_at(row + fe.list_at + count_bytes + k*index_bytes);
+				if (index < 0 || index >= ve.count) ok = false;
+				F(i, k) = static_cast<int>(index);
+			}
+		}, 4096);
+
+		if (ok) {
+			facets.swap(F);
+			return true;
+		}
+	}
+
+	/*Mixed polygons: walk the lists once and fan them*/
+	std::vector<Eigen::RowVector3i> list;
+	list.reserve(fe.count);
+
+	for (long long i = 0; i < fe.count; i++) {
+		if (end - p < fe.stride + count_bytes) return false;
+		const char *at = p + fe.list_at;
+		long long corners = static_cast<long long>(scalar(at, fe.count_type));
+		const char *indices = at + count_bytes;
+		if (corners < 0 || end - indices < corners*index_bytes + (fe.stride - fe.list_at)) return false;
+
+		for (long long k = 2; k < corners; k++) {
+			Eigen::RowVector3i f(static_cast<int>(index_at(indices)), static_cast<int>(index_at(indices + (k - 1)*index_bytes)), static_cast<int>(index_at(indices + k*index_bytes)));
+			if (f.minCoeff() < 0 || f.maxCoeff() >= ve.count) return false;
+			list.push_back(f);
+		}
+		p = indices + corners*index_bytes + (fe.stride - fe.list_at);
+	}
+
+	facets.resize(list.size(), 3);
+	for (int i = 0; i < list.size(); i++) facets.row(i) = list[i];
+	return true;
+}
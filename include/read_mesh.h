@@ -0,0 +1,54 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef READ_MESH_H_
+#define READ_MESH_H_
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <iostream>
+#include <Eigen/dense>
+#include <igl/read_triangle_mesh.h>
+#include "mapped_file.h"
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	/*OBJ and binary PLY through the parallel readers below, any other format through igl::read_triangle_mesh*/
+	bool read_mesh(const std::string &file, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets);
+
+	//************************************
+	// Method:    qrcode::read_obj
+	//
+	// Maps the file and cuts it into chunks at line ends. A first parallel pass counts
+	// the vertex and face records of every chunk, prefix sums turn the counts into
+	// output rows, and a second parallel pass parses each chunk straight into its rows.
+	// Polygons are fanned into triangles; texture and normal indices and every other
+	// record are skipped. Negative (relative) indices are resolved.
+	//************************************
+	bool read_obj(const std::string &file, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets);
+
+	//************************************
+	// Method:    qrcode::read_ply
+	//
+	// binary_little_endian PLY with a vertex element (x, y, z of any scalar type among
+	// other properties) and a face element with one index list. Vertices are decoded in
+	// parallel; faces too when every list holds three indices, otherwise one pass walks
+	// the lists and fans polygons. ASCII and big endian files go to igl::read_triangle_mesh.
+	//************************************
+	bool read_ply(const std::string &file, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets);
+}
+
+#endif // !READ_MESH_H_
@@ -2,29 +2,31 @@
 
 void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets)
 {
+	QR_TRACE_SCOPE("qrcode::reflaction");
+	qrcode::trace::Scope setup("reflaction setup");
 
-	std::string binary_file = "reflaction";
+	const qrcode::ReflactionInput &input = global.job.reflaction;
+	if (!input.ready) {
+		std::cout << "Run Direction light first" << std::endl;
+		return;
+	}
+	if (!global.job.prepare()) {
+		std::cout << "Can not create " << global.job.path("Optimization") << std::endl;
+		return;
+	}
+
+	const Eigen::MatrixXi &black_module_seg = input.black_module_seg;
 
-	Eigen::MatrixXi black_module_seg;
-	
-	igl::deserialize(black_module_seg, "black_module_seg", binary_file);
-	
 	global.black_module_segments.clear();
 	for (int i = 0; i < black_module_seg.rows(); i++) global.black_module_segments.push_back(black_module_seg.row(i).transpose());
 
-	std::cout << global.black_module_segments.size() << std::endl;
-	Eigen::MatrixXi modules;
-	igl::deserialize(modules, "modules", binary_file);
-	int qr_size;
-	igl::deserialize(qr_size, "qr_size", binary_file);
-	int scale;
-	igl::deserialize(scale, "scale", binary_file);
-	int border;
-	igl::deserialize(border, "border", binary_file);
-	Eigen::MatrixXd qr_verticals;
-	igl::deserialize(qr_verticals, "qr_verticals", binary_file);
-	igl::deserialize(verticles, "verticles", binary_file);
-	igl::deserialize(facets, "facets", binary_file);
+	const Eigen::MatrixXi &modules = input.modules;
+	int qr_size = input.qr_size;
+	int scale = input.scale;
+	int border = input.border;
+	Eigen::MatrixXd qr_verticals = input.qr_verticals;
+	verticles = input.verticles;
+	facets = input.facets;
 
 
 	std::vector<qrcode::SMesh> appendix;
@@ -50,10 +52,12 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 			mesh_info[y][x](3, 0) = 4 * global.indicator[y][x](1) + 3;
 		}
 	}
-	std::cout << "ok2" << std::endl;
+	setup.close();
+
+	qrcode::trace::Scope block1("reflaction append walls");
 	int row = 0;
 	for (int i = 0; i < global.black_module_segments.size(); i++) {
-		std::cout << "i" << std::endl;
+		QR_TRACE_SCOPE("reflaction segment");
 
 		Eigen::Vector3i segment = global.black_module_segments[i];
 		int y = segment(0);
@@ -84,7 +88,6 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 				double diff_left = (lower_left_point - upper_left_point) / seg_size;
 				double diff_right = (lower_right_point - upper_right_point) / seg_size;
-				std::cout << "ok3" << std::endl;
 
 				for (int v = 0; v < seg_size; v++) {
 					int index_seg = u*seg_size + v;
@@ -99,13 +102,13 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 					//append_verticals.row(4 * index_seg + 3)<< global.hit_matrix((r + 1)*(qr_size + 1) + c + 1,0), global.hit_matrix((r + 1)*(qr_size + 1) + c + 1, 1),lower_right_point;
 
 					append_verticals.row(4 * index_seg) =
-						global.hit_matrix.row(r*(qr_size + 1) + c) + global.direct.row(r*(qr_size + 1) + c).cast<double>()*(lower_left_point - upper_left_point) / global.direct(r*(qr_size + 1) + c, 2);
+						qrcode::projected_point(global, r*(qr_size + 1) + c) + qrcode::projected_direct(global, r*(qr_size + 1) + c).cast<double>()*(lower_left_point - upper_left_point) / qrcode::projected_direct(global, r*(qr_size + 1) + c)(2);
 					append_verticals.row(4 * index_seg + 1) =
-						global.hit_matrix.row((r + 1)*(qr_size + 1) + c) + global.direct.row((r + 1)*(qr_size + 1) + c).cast<double>()*(lower_right_point - upper_right_point) / global.direct((r + 1)*(qr_size + 1) + c, 2);
+						qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c) + qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c).cast<double>()*(lower_right_point - upper_right_point) / qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c)(2);
 					append_verticals.row(4 * index_seg + 2) =
-						global.hit_matrix.row(r*(qr_size + 1) + c + 1) + global.direct.row(r*(qr_size + 1) + c + 1).cast<double>()*(lower_left_point - upper_left_point) / global.direct(r*(qr_size + 1) + c + 1, 2);
+						qrcode::projected_point(global, r*(qr_size + 1) + c + 1) + qrcode::projected_direct(global, r*(qr_size + 1) + c + 1).cast<double>()*(lower_left_point - upper_left_point) / qrcode::projected_direct(global, r*(qr_size + 1) + c + 1)(2);
 					append_verticals.row(4 * index_seg + 3) =
-						global.hit_matrix.row((r + 1)*(qr_size + 1) + c + 1) + global.direct.row((r + 1)*(qr_size + 1) + c + 1).cast<double>()*(lower_right_point - upper_right_point) / global.direct((r + 1)*(qr_size + 1) + c + 1, 2);
+						qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c + 1) + qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c + 1).cast<double>()*(lower_right_point - upper_right_point) / qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c + 1)(2);
 
 
 					append_facets.emplace_back(4 * index_seg, 4 * index_seg + 1, 4 * index_seg + 2);
@@ -116,31 +119,31 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 
 					/*append_verticals.row(4 * scale*seg_size + 4 * index_seg) <<
-					global.hit_matrix(r*(qr_size + 1) + c, 0),
-					global.hit_matrix(r*(qr_size + 1) + c, 1),
+					qrcode::projected_point(global, r*(qr_size + 1) + c)(0),
+					qrcode::projected_point(global, r*(qr_size + 1) + c)(1),
 					upper_left_point + diff_right*v;
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 1) <<
-					global.hit_matrix((r + 1)*(qr_size + 1) + c, 0),
-					global.hit_matrix((r + 1)*(qr_size + 1) + c, 1),
+					qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c)(0),
+					qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c)(1),
 					upper_right_point + diff_right*v;
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 2) <<
-					global.hit_matrix(r*(qr_size + 1) + c + 1, 0),
-					global.hit_matrix(r*(qr_size + 1) + c + 1, 1),
+					qrcode::projected_point(global, r*(qr_size + 1) + c + 1)(0),
+					qrcode::projected_point(global, r*(qr_size + 1) + c + 1)(1),
 					upper_left_point + diff_left*(v+1);
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 3) <<
-					global.hit_matrix((r + 1)*(qr_size + 1) + c + 1, 0),
-					global.hit_matrix((r + 1)*(qr_size + 1) + c + 1, 1),
+					qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c + 1)(0),
+					qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c + 1)(1),
 					upper_right_point + diff_right*(v+1);*/
 
 
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg) =
-						global.hit_matrix.row(r*(qr_size + 1) + c) + global.direct.row(r*(qr_size + 1) + c).cast<double>()* v *diff_left / global.direct(r*(qr_size + 1) + c, 2);
+						qrcode::projected_point(global, r*(qr_size + 1) + c) + qrcode::projected_direct(global, r*(qr_size + 1) + c).cast<double>()* v *diff_left / qrcode::projected_direct(global, r*(qr_size + 1) + c)(2);
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 1) =
-						global.hit_matrix.row((r + 1)*(qr_size + 1) + c) + global.direct.row((r + 1)*(qr_size + 1) + c).cast<double>()* v *diff_right / global.direct((r + 1)*(qr_size + 1) + c, 2);
+						qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c) + qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c).cast<double>()* v *diff_right / qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c)(2);
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 2) =
-						global.hit_matrix.row(r*(qr_size + 1) + c + 1) + global.direct.row(r*(qr_size + 1) + c + 1).cast<double>()* (v + 1) *diff_left / global.direct(r*(qr_size + 1) + c + 1, 2);
+						qrcode::projected_point(global, r*(qr_size + 1) + c + 1) + qrcode::projected_direct(global, r*(qr_size + 1) + c + 1).cast<double>()* (v + 1) *diff_left / qrcode::projected_direct(global, r*(qr_size + 1) + c + 1)(2);
 					append_verticals.row(4 * scale*seg_size + 4 * index_seg + 3) =
-						global.hit_matrix.row((r + 1)*(qr_size + 1) + c + 1) + global.direct.row((r + 1)*(qr_size + 1) + c + 1).cast<double>()* (v + 1) *diff_right / global.direct((r + 1)*(qr_size + 1) + c + 1, 2);
+						qrcode::projected_point(global, (r + 1)*(qr_size + 1) + c + 1) + qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c + 1).cast<double>()* (v + 1) *diff_right / qrcode::projected_direct(global, (r + 1)*(qr_size + 1) + c + 1)(2);
 
 
 					append_facets.emplace_back(4 * scale*seg_size + 4 * index_seg, 4 * scale*seg_size + 4 * index_seg + 2, 4 * scale*seg_size + 4 * index_seg + 1);
@@ -179,8 +182,6 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 				}
 			}
-			std::cout << append_verticals.rows() << std::endl;
-			std::cout << "ok4" << std::endl;
 
 			for (int u = 0; u < scale-1; u++) {
 				int seg_size = scale*temp_len;
@@ -268,7 +269,6 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 				}
 			}
-			std::cout << "ok5" << std::endl;
 			Eigen::MatrixXi f(append_facets.size(), 3);
 			for (int j = 0; j < append_facets.size(); j++) f.row(j) = append_facets[j].transpose();
 			appendix.push_back({ append_verticals, f });
@@ -277,7 +277,6 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 	}
 
-	std::cout << "ok6" << std::endl;
 	for (int i = 0; i < appendix.size(); i++) {
 		int v_row = verticles.rows();
 		int f_row = facets.rows();
@@ -287,7 +286,9 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 		facets.conservativeResize(f_row + appendix[i].F.rows(), 3);
 		facets.block(f_row, 0, appendix[i].F.rows(), 3) = (appendix[i].F.array() + v_row).matrix();
 	}
-	std::cout << "end of block 1" << std::endl;
+	block1.close();
+
+	qrcode::trace::Scope block2("reflaction stitch walls");
 	std::vector<Eigen::Vector3i> face;
 
 	for (int i = 0; i < global.black_module_segments.size(); i++) {
@@ -610,7 +611,9 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 	int origin_row = facets.rows();
 	facets.conservativeResize(origin_row + add_facets.rows(), 3);
 	facets.block(origin_row, 0, add_facets.rows(), 3) = add_facets;
-	std::cout << "end of block 2" << std::endl;
+	block2.close();
+
+	QR_TRACE_SCOPE("reflaction dedup facets");
 	std::vector<Eigen::Vector3i> face_vec;
 	for (int i = 0; i < facets.rows(); i++) face_vec.push_back(facets.row(i));
 	std::sort(face_vec.begin(), face_vec.end(), [](Eigen::Vector3i v1, Eigen::Vector3i v2) {
@@ -640,8 +643,6 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 
 	});
 
-	std::cout << "block3" << std::endl;
-
 	face_vec.erase(std::unique(face_vec.begin(), face_vec.end(), [](Eigen::Vector3i v1, Eigen::Vector3i v2) {
 		int a, b;
 		int max1 = v1.maxCoeff(&a);
@@ -664,5 +665,5 @@ void qrcode::reflaction(GLOBAL & global, Eigen::MatrixXd & verticles, Eigen::Mat
 	for (int i = 0; i < face_vec.size(); i++) facets.row(i) = face_vec[i];
 
 
-	igl::writeOBJ("Optimization/final_model.obj", verticles, facets);
+	qrcode::write_mesh(global.job.path("Optimization/final_model.ply"), verticles, facets);
 }
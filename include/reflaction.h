@@ -8,11 +8,13 @@
 #ifndef REFLACTION
 #include<vector>
 #include<algorithm>
+#include<iostream>
 #include<igl/serialize.h>
-#include<igl/writeOBJ.h>
 #include "sphere_mesh.h"
 #include "global.h"
 #include "carving_down.h"
+#include "write_mesh.h"
+#include "trace.h"
 namespace qrcode {
 	void reflaction(GLOBAL &global, Eigen::MatrixXd &verticles, Eigen::MatrixXi&facets);
 }
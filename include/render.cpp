@@ -0,0 +1,70 @@
+#include "render.h"
+
+void qrcode::render(const igl::embree::EmbreeIntersector & ei, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, RenderCamera & camera,
+	Eigen::VectorXf & source, int samples, std::uint64_t seed, int background, Eigen::MatrixXi & image)
+{
+	QR_TRACE_SCOPE("qrcode::render");
+	const int width = camera.width;
+	const int height = camera.height;
+	image.setConstant(height, width, background);
+
+	/*Camera frame*/
+	Eigen::Vector3f forward = (camera.center - camera.eye).normalized();
+	Eigen::Vector3f right = forward.cross(camera.up).normalized();
+	Eigen::Vector3f up = right.cross(forward);
+
+	float half_height = std::tan(camera.fov / 360 * igl::PI);
+	float half_width = half_height*width / height;
+
+	const Eigen::Vector3f l = source.head(3);
+	const Eigen::Vector3f eye = camera.eye;
+	const auto shade_row = [&](const int y)
+	{
+		const float tnear = 1e-3f;
+
+		for (int x = 0; x < width; x++) {
+			float u = (2 * (x + 0.5f) / width - 1)*half_width;
+			float v = (1 - 2 * (y + 0.5f) / height)*half_height;
+			Eigen::Vector3f dir = (forward + u*right + v*up).normalized();
+
+			igl::Hit hit;
+			if (!ei.intersectRay(eye, dir, hit, tnear)) continue;
+
+			/*Hit point and the facet normal turned towards the camera*/
+			Eigen::Vector3f a = verticles.row(facets(hit.id, 0)).cast<float>().transpose();
+			Eigen::Vector3f b = verticles.row(facets(hit.id, 1)).cast<float>().transpose();
+			Eigen::Vector3f c = verticles.row(facets(hit.id, 2)).cast<float>().transpose();
+
+			Eigen::Vector3f p = (1 - hit.u - hit.v)*a + hit.u*b + hit.v*c;
+			Eigen::Vector3f n = (b - a).cross(c - a).normalized();
+			if (n.dot(dir) > 0) n *= -1;
+
+			/*Direct light with shadow*/
+			Eigen::Vector3f to_light = (l - p).normalized();
+			float direct = 0.f;
+			igl::Hit shadow;
+			if (to_light.dot(n) > 0 && !ei.intersectRay(p, to_light, shadow, tnear))
+				direct = to_light.dot(n);
+
+			/*Ambient occlusion as ambient_occlusion traces it, a cosine Halton set rotated per pixel*/
+			const qrcode::CosineSampler sampler(n, static_cast<std::uint64_t>(y)*width + x, seed, qrcode::RNGDomain::Render);
+			int open = 0;
+			for (int s = 0; s < samples; s++) {
+				igl::Hit occluder;
+				if (!ei.intersectRay(p, sampler.direction(s), occluder, tnear)) open++;
+			}
+			float ambient = samples > 0 ? static_cast<float>(open) / samples : 1.f;
+
+			image(y, x) = std::min(255, std::max(0, qrcode::light_to_gray(ambient, direct)));
+		}
+	};
+	qrcode::parallel_for(height, shade_row, 1);
+}
+
+void qrcode::render(const igl::embree::EmbreeIntersector & ei, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, RenderCamera & camera,
+	Eigen::VectorXf & source, int samples, std::uint64_t seed, std::string file)
+{
+	Eigen::MatrixXi image;
+	qrcode::render(ei, verticles, facets, camera, source, samples, seed, 0, image);
+	qrcode::write_gray(file, image);
+}
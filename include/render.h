@@ -0,0 +1,56 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef RENDER_H_
+#define RENDER_H_
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <Eigen/dense>
+#include <igl/embree/EmbreeIntersector.h>
+#include <igl/Hit.h>
+#include <igl/PI.h>
+#include "counter_rng.h"
+#include "ambient_occlusion.h"
+#include "Light.h"
+#include "writePNG.h"
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	struct RenderCamera
+	{
+		Eigen::Vector3f eye, center, up;//model space
+		float fov;//vertical field of view in degrees
+		int width, height;
+	};
+
+	//************************************
+	// Method:    qrcode::render
+	//
+	// CPU reference image of the merged mesh as the scanner would see it. Every pixel
+	// shoots one camera ray, and the hit point is shaded with the same model as the
+	// optimiser: a shadow ray to the point light, ambient occlusion from the cosine
+	// Halton sampler of qrcode::ambient_occlusion with a stream per pixel, and
+	// qrcode::light_to_gray. Rows are rendered in parallel.
+	//
+	// @param const igl::embree::EmbreeIntersector & ei  BVH of verticles/facets
+	// @param Eigen::VectorXf & source  point light in model space
+	// @param int samples  ambient occlusion rays per pixel
+	// @param std::uint64_t seed  job seed, GLOBAL::seed
+	// @param int background  gray value of pixels that miss the mesh
+	// @param Eigen::MatrixXi & image  height x width gray values
+	//************************************
+	void render(const igl::embree::EmbreeIntersector &ei, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, RenderCamera &camera,
+		Eigen::VectorXf &source, int samples, std::uint64_t seed, int background, Eigen::MatrixXi &image);
+	/*Writes the image to file*/
+	void render(const igl::embree::EmbreeIntersector &ei, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, RenderCamera &camera,
+		Eigen::VectorXf &source, int samples, std::uint64_t seed, std::string file);
+}
+
+#endif // !RENDER_H_
@@ -0,0 +1,22 @@
+#include "solid_angle.h"
+
+void qrcode::solid_angle(const Eigen::Vector3f & origin, const Eigen::MatrixXd & verticles, const Eigen::MatrixXi & facets, Eigen::VectorXf & result)
+{
+	const int n = facets.rows();
+
+	Eigen::MatrixXf _V = (verticles.cast<float>().rowwise() - origin.transpose()).rowwise().normalized();
+
+	/*Structure of arrays, one column per corner coordinate*/
+	Eigen::ArrayXf ax(n), ay(n), az(n), bx(n), by(n), bz(n), cx(n), cy(n), cz(n);
+	for (int i = 0; i < n; i++) {
+		ax(i) = _V(facets(i, 0), 0); ay(i) = _V(facets(i, 0), 1); az(i) = _V(facets(i, 0), 2);
+		bx(i) = _V(facets(i, 1), 0); by(i) = _V(facets(i, 1), 1); bz(i) = _V(facets(i, 1), 2);
+		cx(i) = _V(facets(i, 2), 0); cy(i) = _V(facets(i, 2), 1); cz(i) = _V(facets(i, 2), 2);
+	}
+
+	Eigen::ArrayXf det = (ax*(by*cz - bz*cy) + ay*(bz*cx - bx*cz) + az*(bx*cy - by*cx)).abs();
+	Eigen::ArrayXf den = 1 + (ax*bx + ay*by + az*bz) + (bx*cx + by*cy + bz*cz) + (cx*ax + cy*ay + cz*az);
+
+	result.resize(n);
+	for (int i = 0; i < n; i++) result(i) = 2 * std::atan2(det(i), den(i));
+}
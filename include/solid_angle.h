@@ -0,0 +1,28 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef SOLID_ANGLE_H_
+#define SOLID_ANGLE_H_
+#include <cmath>
+#include <Eigen/dense>
+namespace qrcode {
+
+	//************************************
+	// Method:    qrcode::solid_angle
+	//
+	// Unsigned solid angle of every triangle seen from origin, Van Oosterom and Strackee:
+	// tan(omega/2) = |a.(b x c)| / (1 + a.b + b.c + c.a) for unit a, b, c. The triangles
+	// are gathered into coordinate arrays first, so everything but the final atan2 runs
+	// as packed Eigen array arithmetic.
+	//
+	// @param Eigen::VectorXf & result  facets.rows() solid angles in [0, 2*pi]
+	//************************************
+	void solid_angle(const Eigen::Vector3f &origin, const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets, Eigen::VectorXf &result);
+}
+
+#endif // !SOLID_ANGLE_H_
@@ -0,0 +1,226 @@
+#include "task_scheduler.h"
+
+namespace {
+
+	typedef std::function<void()> Task;
+
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	thread_local int worker_id = -1;
+
+	class Pool
+	{
+	public:
+		static Pool &instance()
+		{
+			static Pool pool;
+			return pool;
+		}
+
+		~Pool()
+		{
+			shutdown();
+		}
+
+		void configure(int n)
+		{
+			if (n <= 0) n = std::max(1u, std::thread::hardware_concurrency());
+
+			std::lock_guard<std::mutex> guard(config_lock);
+			shutdown();
+
+			stop = false;
+			queues.clear();
+			for (int i = 0; i < n - 1; i++) queues.push_back(std::unique_ptr<Queue>(new Queue));
+			for (int i = 0; i < n - 1; i++) threads.push_back(std::thread(&Pool::loop, this, i));
+			total = n;
+		}
+
+		int size() const
+		{
+			return total;
+		}
+
+		void submit(const Task &task)
+		{
+			Queue &q = worker_id >= 0 ? *queues[worker_id] : injection;
+			{
+				std::lock_guard<std::mutex> guard(q.lock);
+				q.tasks.push_back(task);
+			}
+			queued++;
+
+			/*Sleepers register before testing queued, so a worker is never left asleep*/
+			if (sleeping.load() > 0) {
+				{
+					std::lock_guard<std::mutex> guard(sleep_lock);
+				}
+				wake.notify_one();
+			}
+		}
+
+		/*Runs one queued task if there is any*/
+		bool help()
+		{
+			Task task;
+			if (!take(worker_id, task)) return false;
+			task();
+			return true;
+		}
+
+	private:
+		Pool() : stop(false), queued(0), sleeping(0), total(1)
+		{
+			configure(0);
+		}
+
+		void shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> guard(sleep_lock);
+				stop = true;
+			}
+			wake.notify_all();
+			for (int i = 0; i < threads.size(); i++) threads[i].join();
+			threads.clear();
+		}
+
+		bool pop(Queue &q, bool back, Task &task)
+		{
+			std::lock_guard<std::mutex> guard(q.lock);
+			if (q.tasks.empty()) return false;
+			if (back) {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+			else {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			return true;
+		}
+
+		bool take(int self, Task &task)
+		{
+			bool found = (self >= 0 && pop(*queues[self], true, task)) || pop(injection, false, task);
+
+			/*Steal the oldest, usually largest, task of another worker*/
+			const int n = queues.size();
+			for (int k = 1; !found && k <= n; k++) {
+				int victim = ((self < 0 ? 0 : self) + k) % n;
+				if (victim != self) found = pop(*queues[victim], false, task);
+			}
+
+			if (found) queued--;
+			return found;
+		}
+
+		void loop(int id)
+		{
+			worker_id = id;
+			while (true) {
+				if (help()) continue;
+
+				std::unique_lock<std::mutex> guard(sleep_lock);
+				sleeping++;
+				wake.wait(guard, [this]() { return stop || queued.load() > 0; });
+				sleeping--;
+				if (stop) break;
+			}
+			worker_id = -1;
+		}
+
+		std::mutex config_lock;
+		std::vector<std::unique_ptr<Queue>> queues;
+		Queue injection;
+		std::vector<std::thread> threads;
+
+		std::mutex sleep_lock;
+		std::condition_variable wake;
+		bool stop;
+		std::atomic<int> queued, sleeping;
+		int total;
+	};
+}
+
+void qrcode::set_num_threads(int n)
+{
+	Pool::instance().configure(n);
+}
+
+int qrcode::num_threads()
+{
+	return Pool::instance().size();
+}
+
+qrcode::TaskGroup::TaskGroup() : state(std::make_shared<State>())
+{
+	state->pending = 0;
+}
+
+qrcode::TaskGroup::~TaskGroup()
+{
+	while (state->pending.load() > 0)
+		if (!Pool::instance().help()) std::this_thread::yield();
+}
+
+void qrcode::TaskGroup::run(const std::function<void()>& task)
+{
+	std::shared_ptr<State> s = state;
+	s->pending++;
+
+	Pool::instance().submit([s, task]() {
+		try {
+			task();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(s->lock);
+			if (!s->error) s->error = std::current_exception();
+		}
+		s->pending--;
+	});
+}
+
+void qrcode::TaskGroup::wait()
+{
+	while (state->pending.load() > 0)
+		if (!Pool::instance().help()) std::this_thread::yield();
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		std::swap(error, state->error);
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+void qrcode::detail::submit(const std::function<void()>& task)
+{
+	Pool::instance().submit(task);
+}
+
+void qrcode::detail::parallel_chunks(long long n, long long grain, const std::function<void(long long, long long)>& body)
+{
+	if (n <= 0) return;
+
+	const long long threads = Pool::instance().size();
+	if (grain <= 0) grain = std::max(1LL, n / (8 * threads));
+
+	if (threads <= 1 || n <= grain) {
+		body(0, n);
+		return;
+	}
+
+	TaskGroup group;
+	for (long long begin = grain; begin < n; begin += grain) {
+		long long end = std::min(n, begin + grain);
+		group.run([&body, begin, end]() { body(begin, end); });
+	}
+	/*The caller takes the first chunk itself*/
+	body(0, std::min(n, grain));
+	group.wait();
+}
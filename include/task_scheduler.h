@@ -0,0 +1,92 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef TASK_SCHEDULER_H_
+#define TASK_SCHEDULER_H_
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
+namespace qrcode {
+
+	/*
+	Project wide work stealing pool. Every worker owns a deque: it pushes and pops its
+	own tasks at the back and steals from the front of the others, and threads outside
+	the pool inject through a shared queue. A thread that waits on a TaskGroup runs
+	queued tasks meanwhile, so parallel loops can nest without deadlocking.
+	*/
+
+	/*Total threads including the caller, 0 for the hardware concurrency; call while idle*/
+	void set_num_threads(int n);
+	int num_threads();
+
+	class TaskGroup
+	{
+	public:
+		TaskGroup();
+		/*Waits for the tasks that are still running*/
+		~TaskGroup();
+
+		void run(const std::function<void()> &task);
+		/*Helps until every task of the group has finished, then rethrows the first exception*/
+		void wait();
+
+	private:
+		TaskGroup(const TaskGroup &);
+		TaskGroup &operator=(const TaskGroup &);
+
+		struct State
+		{
+			std::atomic<int> pending;
+			std::mutex lock;
+			std::exception_ptr error;
+		};
+		std::shared_ptr<State> state;
+	};
+
+	namespace detail {
+		void submit(const std::function<void()> &task);
+		void parallel_chunks(long long n, long long grain, const std::function<void(long long, long long)> &body);
+	}
+
+	//************************************
+	// Method:    qrcode::parallel_for
+	//
+	// Calls f(i) for i in [0, n). The range is cut into chunks of at least grain
+	// items; grain 0 aims at about eight chunks per thread, which suits loops whose
+	// items cost a ray cast or more. Small ranges and single thread pools run inline.
+	//************************************
+	template<typename Index, typename F>
+	void parallel_for(Index n, const F &f, long long grain = 0)
+	{
+		detail::parallel_chunks(static_cast<long long>(n), grain, [&f](long long begin, long long end) {
+			for (long long i = begin; i < end; i++) f(static_cast<Index>(i));
+		});
+	}
+
+	/*Runs f on the pool; prefer a TaskGroup when waiting from inside a task*/
+	template<typename F>
+	std::future<typename std::result_of<F()>::type> async(F f)
+	{
+		typedef typename std::result_of<F()>::type R;
+		std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(f);
+		std::future<R> result = task->get_future();
+		detail::submit([task]() { (*task)(); });
+		return result;
+	}
+}
+
+#endif // !TASK_SCHEDULER_H_
@@ -0,0 +1,159 @@
+#include "trace.h"
+
+namespace {
+
+	struct Event
+	{
+		const char *name;
+		long long begin, end;//microseconds since start
+	};
+
+	/*One buffer per thread, kept alive by the registry after the thread exits*/
+	struct Buffer
+	{
+		std::mutex lock;
+		std::vector<Event> events;
+		int tid;
+	};
+
+	std::atomic<bool> recording(false);
+	std::mutex registry_lock;
+	std::vector<std::shared_ptr<Buffer>> registry;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Buffer &local()
+	{
+		thread_local std::shared_ptr<Buffer> buffer;
+		if (!buffer) {
+			buffer = std::make_shared<Buffer>();
+			std::lock_guard<std::mutex> guard(registry_lock);
+			buffer->tid = registry.size();
+			registry.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	/*Snapshot of every recorded event with its thread id*/
+	std::vector<std::pair<int, Event>> collect()
+	{
+		std::vector<std::pair<int, Event>> all;
+		std::lock_guard<std::mutex> guard(registry_lock);
+		for (int i = 0; i < registry.size(); i++) {
+			std::lock_guard<std::mutex> buffer_guard(registry[i]->lock);
+			for (int k = 0; k < registry[i]->events.size(); k++)
+				all.push_back(std::make_pair(registry[i]->tid, registry[i]->events[k]));
+		}
+		return all;
+	}
+
+	std::string escape(const char *s)
+	{
+		std::string out;
+		for (; *s; s++) {
+			if (*s == '"' || *s == '\\') out += '\\';
+			out += *s;
+		}
+		return out;
+	}
+}
+
+void qrcode::trace::enable(bool on)
+{
+	recording.store(on);
+}
+
+bool qrcode::trace::enabled()
+{
+	return recording.load(std::memory_order_relaxed);
+}
+
+void qrcode::trace::clear()
+{
+	std::lock_guard<std::mutex> guard(registry_lock);
+	for (int i = 0; i < registry.size(); i++) {
+		std::lock_guard<std::mutex> buffer_guard(registry[i]->lock);
+		registry[i]->events.clear();
+	}
+}
+
+bool qrcode::trace::export_chrome(const std::string & file)
+{
+	std::ofstream out(file);
+	if (!out) return false;
+
+	std::vector<std::pair<int, Event>> all = collect();
+
+	out << "{\"traceEvents\":[";
+	for (int i = 0; i < all.size(); i++) {
+		const Event &e = all[i].second;
+		out << (i ? ",\n" : "\n")
+			<< "{\"name\":\"" << escape(e.name) << "\",\"cat\":\"qrcode\",\"ph\":\"X\",\"pid\":1,\"tid\":" << all[i].first
+			<< ",\"ts\":" << e.begin << ",\"dur\":" << e.end - e.begin << "}";
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return static_cast<bool>(out);
+}
+
+std::string qrcode::trace::summary()
+{
+	struct Total
+	{
+		int count;
+		long long sum, max;
+	};
+
+	std::map<std::string, Total> totals;
+	std::vector<std::pair<int, Event>> all = collect();
+
+	for (int i = 0; i < all.size(); i++) {
+		const Event &e = all[i].second;
+		Total &t = totals.insert(std::make_pair(std::string(e.name), Total{ 0, 0, 0 })).first->second;
+		t.count++;
+		t.sum += e.end - e.begin;
+		t.max = std::max(t.max, e.end - e.begin);
+	}
+
+	std::vector<std::pair<std::string, Total>> rows(totals.begin(), totals.end());
+	std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, Total> &a, const std::pair<std::string, Total> &b) {
+		return a.second.sum > b.second.sum;
+	});
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3)
+		<< std::left << std::setw(40) << "stage" << std::right << std::setw(10) << "count"
+		<< std::setw(14) << "total(s)" << std::setw(14) << "mean(ms)" << std::setw(14) << "max(ms)" << "\n";
+
+	for (int i = 0; i < rows.size(); i++) {
+		const Total &t = rows[i].second;
+		out << std::left << std::setw(40) << rows[i].first << std::right << std::setw(10) << t.count
+			<< std::setw(14) << t.sum*1e-6 << std::setw(14) << t.sum*1e-3 / t.count << std::setw(14) << t.max*1e-3 << "\n";
+	}
+	return out.str();
+}
+
+qrcode::trace::Scope::Scope(const char * name) : name(name), begin(-1)
+{
+	if (enabled()) begin = now();
+}
+
+qrcode::trace::Scope::~Scope()
+{
+	close();
+}
+
+void qrcode::trace::Scope::close()
+{
+	if (begin < 0) return;
+
+	Event e = { name, begin, now() };
+	begin = -1;
+
+	Buffer &buffer = local();
+	std::lock_guard<std::mutex> guard(buffer.lock);
+	buffer.events.push_back(e);
+}
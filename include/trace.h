@@ -0,0 +1,63 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef QR_TRACE_H_
+#define QR_TRACE_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+namespace qrcode {
+	namespace trace {
+
+		/*Recording is off by default; a disabled span costs one relaxed atomic load*/
+		void enable(bool on);
+		bool enabled();
+		void clear();
+
+		/*Chrome trace-event JSON, open with chrome://tracing or ui.perfetto.dev*/
+		bool export_chrome(const std::string &file);
+		/*Count, total, mean and max time of every span name, slowest first*/
+		std::string summary();
+
+		class Scope
+		{
+		public:
+			explicit Scope(const char *name);
+			~Scope();
+			/*Ends the span before the end of the block, later calls do nothing*/
+			void close();
+
+		private:
+			Scope(const Scope &);
+			Scope &operator=(const Scope &);
+
+			const char *name;
+			long long begin;
+		};
+	}
+}
+
+#define QR_TRACE_CONCAT_(a, b) a##b
+#define QR_TRACE_CONCAT(a, b) QR_TRACE_CONCAT_(a, b)
+
+#ifdef QR_NO_TRACE
+#define QR_TRACE_SCOPE(name)
+#else
+/*Times the enclosing block under name, which must be a string literal*/
+#define QR_TRACE_SCOPE(name) qrcode::trace::Scope QR_TRACE_CONCAT(qr_trace_scope_, __LINE__)(name)
+#endif
+
+#endif // !QR_TRACE_H_
@@ -0,0 +1,114 @@
+#include "validation.h"
+
+void qrcode::validation(GLOBAL & global, std::vector<Eigen::MatrixXi>& modules, Eigen::MatrixXd & verticles, Eigen::MatrixXi & facets, Eigen::MatrixXd & qr_verticals,
+	Eigen::VectorXf & centroid, std::vector<Eigen::Vector2f>& angles, int samples, std::vector<Eigen::MatrixXi>& gray, std::vector<ValidationStats>& stats)
+{
+	QR_TRACE_SCOPE("qrcode::validation");
+	const auto radian = [](float angle)->float {return angle / 180 * igl::PI; };
+
+	int qr_size = (global.info.pixels.size() + 2 * global.info.border)*global.info.scale;
+	const int n = global.anti_indicatior.size();
+	const int m = angles.size();
+
+	Eigen::MatrixXf position, normal;
+	qrcode::pre_pixel_normal(global, qr_verticals, position, normal);
+
+	/*White cells get ambient occlusion, black cells keep 1*/
+	std::vector<Eigen::Vector3f> white_position, white_normal;
+	std::vector<int> white_cells;
+	Eigen::VectorXi white_index;
+	white_index.setConstant(n, -1);
+
+	for (int i = 0; i < n; i++) {
+		int y = global.anti_indicatior[i](0);
+		int x = global.anti_indicatior[i](1);
+
+		if (modules[0](y, x) == 0 && modules[1](y, x) == 0) {
+			white_index(i) = white_position.size();
+			white_cells.push_back(i);
+			white_position.push_back(position.row(i).transpose());
+			white_normal.push_back(normal.row(i).transpose());
+		}
+	}
+
+	igl::embree::EmbreeIntersector ei;
+	ei.init(verticles.cast<float>(), facets);
+
+	Eigen::VectorXf white_AO;
+	global.ao_cache.ambient_occlusion(global, ei, white_cells, white_position, white_normal, samples, qrcode::AOSampling::Progressive, white_AO);
+
+	/*Light sources in model space*/
+	Eigen::Matrix4f model = global.mode.inverse().eval();
+	std::vector<Eigen::Vector3f> source(m);
+
+	for (int a = 0; a < m; a++) {
+		float latitude = radian(angles[a](0));
+		float longitude = radian(angles[a](1));
+
+		Eigen::Vector3f elevation(std::cos(latitude)*std::cos(longitude), std::cos(latitude)*std::sin(longitude), std::sin(latitude));
+		Eigen::Vector4f s;
+		s << centroid.head(3) + elevation*global.zoom*global.distance, 1.f;
+		source[a] = (model*s).head(3);
+	}
+
+	/*Direct term of every (cell, angle) pair*/
+	Eigen::MatrixXf direct(n, m);
+
+	const auto shade = [&](const int e)
+	{
+		const int i = e % n;
+		const int a = e / n;
+
+		Eigen::Vector3f s = position.row(i).transpose();
+		Eigen::Vector3f dir = (source[a] - s).normalized();
+
+		igl::Hit hit;
+		const float tnear = 1e-3f;
+		direct(i, a) = ei.intersectRay(s, dir, hit, tnear) ? 0.f : dir.dot(normal.row(i).transpose());
+	};
+	qrcode::parallel_for(n*m, shade);
+
+	/*Gray images and contrast*/
+	gray.resize(m);
+	stats.resize(m);
+
+	const auto summarize = [&](const int a)
+	{
+		gray[a].setConstant(qr_size, qr_size, 255);
+
+		ValidationStats &st = stats[a];
+		st.latitude = angles[a](0);
+		st.longitude = angles[a](1);
+		st.white_min = 255;
+		st.black_max = 0;
+
+		float white_sum = 0, black_sum = 0;
+		int white_count = 0, black_count = 0;
+
+		for (int i = 0; i < n; i++) {
+			int y = global.anti_indicatior[i](0);
+			int x = global.anti_indicatior[i](1);
+
+			bool white = white_index(i) >= 0;
+			int value = qrcode::light_to_gray(white ? white_AO(white_index(i)) : 1.f, direct(i, a));
+			gray[a](y, x) = value;
+
+			if (white) {
+				white_sum += value;
+				white_count++;
+				st.white_min = std::min(st.white_min, value);
+			}
+			else {
+				black_sum += value;
+				black_count++;
+				st.black_max = std::max(st.black_max, value);
+			}
+		}
+
+		st.white_mean = white_count > 0 ? white_sum / white_count : 0.f;
+		st.black_mean = black_count > 0 ? black_sum / black_count : 0.f;
+		st.contrast = st.white_mean - st.black_mean;
+		st.margin = st.white_min - st.black_max;
+	};
+	qrcode::parallel_for(m, summarize, 1);
+}
@@ -0,0 +1,53 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef VALIDATION_H_
+#define VALIDATION_H_
+#include <vector>
+#include <algorithm>
+#include <Eigen/dense>
+#include <igl/embree/EmbreeIntersector.h>
+#include <igl/Hit.h>
+#include <igl/PI.h>
+#include "global.h"
+#include "pre_pixel_normal.h"
+#include "ambient_occlusion.h"
+#include "Light.h"
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	struct ValidationStats
+	{
+		float latitude, longitude;
+		float white_mean, black_mean;
+		int white_min, black_max;
+		float contrast;//white_mean - black_mean
+		int margin;//white_min - black_max, a readable code keeps it positive
+	};
+
+	//************************************
+	// Method:    qrcode::validation
+	//
+	// Simulates the carved code under every validation light at once. One BVH and one
+	// ambient occlusion pass are shared by all angles, the shadow rays of every
+	// (angle, cell) pair run in a single parallel loop. White cell AO goes through
+	// global.ao_cache, so cells untouched since the last lookup are not traced again.
+	//
+	// @param std::vector<Eigen::MatrixXi> & modules  upper and lower black modules
+	// @param Eigen::VectorXf & centroid  model center in view space, the lights are placed around it
+	// @param std::vector<Eigen::Vector2f> & angles  (latitude, longitude) in degrees
+	// @param int samples  cap on the progressive ambient occlusion rays per white cell
+	// @param std::vector<Eigen::MatrixXi> & gray  simulated gray image of every angle
+	// @param std::vector<ValidationStats> & stats  contrast of every angle
+	//************************************
+	void validation(GLOBAL &global, std::vector<Eigen::MatrixXi> &modules, Eigen::MatrixXd &verticles, Eigen::MatrixXi &facets, Eigen::MatrixXd &qr_verticals,
+		Eigen::VectorXf &centroid, std::vector<Eigen::Vector2f> &angles, int samples, std::vector<Eigen::MatrixXi> &gray, std::vector<ValidationStats> &stats);
+}
+
+#endif // !VALIDATION_H_
@@ -2,6 +2,7 @@
 
 std::vector<qrcode::SMesh> qrcode::visible_mesh_on_sphere(std::vector<Eigen::Vector3i>& position, std::vector<Eigen::MatrixXi>& decrement, GLOBAL & global)
 {
+	QR_TRACE_SCOPE("qrcode::visible_mesh_on_sphere");
 	std::vector<qrcode::SMesh> meshes(position.size());
 
 	int scale = global.info.scale;
@@ -21,14 +22,14 @@ std::vector<qrcode::SMesh> qrcode::visible_mesh_on_sphere(std::vector<Eigen::Vec
 			int y1 = floor(bound[k](0));
 			int x2 = x1 + 1;
 			int y2 = y1 + 1;
-			meshes[p].V.row(k) = global.hit_matrix.row(x1*col + y1) + (bound[k](1) - floor(bound[k](1)))
-				*(global.hit_matrix.row((x1 + 1)*col + y1) - global.hit_matrix.row(x1*col + y1)) +
-				(bound[k](0) - floor(bound[k](0)))*(global.hit_matrix.row(x1*col + y1 + 1) - global.hit_matrix.row(x1*col + y1));
+			meshes[p].V.row(k) = qrcode::projected_point(global, x1*col + y1) + (bound[k](1) - floor(bound[k](1)))
+				*(qrcode::projected_point(global, (x1 + 1)*col + y1) - qrcode::projected_point(global, x1*col + y1)) +
+				(bound[k](0) - floor(bound[k](0)))*(qrcode::projected_point(global, x1*col + y1 + 1) - qrcode::projected_point(global, x1*col + y1));
 		}
 
 
 
-		meshes[p].V.row(meshes[p].V.rows() - 1) = (global.hit_matrix.row(position[p](0)*col + position[p](1)) + global.hit_matrix.row((position[p](0) + 1)*col 
+		meshes[p].V.row(meshes[p].V.rows() - 1) = (qrcode::projected_point(global, position[p](0)*col + position[p](1)) + qrcode::projected_point(global, (position[p](0) + 1)*col 
 			+ position[p](1) + 1)) / 2;
 
 		
@@ -62,6 +63,6 @@ std::vector<qrcode::SMesh> qrcode::visible_mesh_on_sphere(std::vector<Eigen::Vec
 
 	
 
-	igl::parallel_for(position.size(), vis, 1000);
+	qrcode::parallel_for(position.size(), vis);
 	return meshes;
 }
@@ -10,10 +10,11 @@
 #define VISIBLE_MESH_ON_SPHERE_H_
 #include <vector>
 #include <Eigen/dense>
-#include <igl/parallel_for.h>
 #include "global.h"
 #include "sphere_mesh.h"
 #include "raw_to_visible_polygon.h"
+#include "task_scheduler.h"
+#include "trace.h"
 namespace qrcode {
 
 	//************************************
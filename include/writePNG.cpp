@@ -113,3 +113,14 @@ void qrcode::write_png(std::string file, Eigen::MatrixXi & modules)
 	}
 	igl::png::writePNG(R, G, B, A, file);
 }
+
+void qrcode::write_gray(std::string file, Eigen::MatrixXi & image)
+{
+	Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> R, A;
+	R.resize(image.cols(), image.rows());
+	A.setConstant(image.cols(), image.rows(), 255);
+	for (int y = 0; y < image.rows(); y++)
+		for (int x = 0; x < image.cols(); x++)
+			R(x, image.rows() - 1 - y) = static_cast<unsigned char>(image(y, x));
+	igl::png::writePNG(R, R, R, A, file);
+}
@@ -16,6 +16,8 @@ namespace qrcode {
 	void write_png(std::string file, Eigen::MatrixXi & modules, Eigen::MatrixXi & modules_c, int scale);
 	void write_png1(std::string file, Eigen::MatrixXi & modules, Eigen::MatrixXi & modules_c, int scale);
 	void write_png(std::string file, Eigen::MatrixXi &modules);
+	/*Gray image of any size, image(0,0) is the top left pixel*/
+	void write_gray(std::string file, Eigen::MatrixXi &image);
 }
 #endif // !WRITE_PNG_H_
 
@@ -0,0 +1,169 @@
+#include "write_mesh.h"
+
+namespace {
+	/*Fixed buffer in front of fwrite, values go out little endian whatever the host*/
+	class Stream
+	{
+	public:
+		explicit Stream(std::FILE *file) :file(file), used(0), failed(false), block(1 << 20) {}
+		~Stream() { flush(); }
+
+		void bytes(const void *data, std::size_t n)
+		{
+			if (used + n > block.size()) flush();
+			std::memcpy(&block[used], data, n);
+			used += n;
+		}
+
+		void u32(std::uint32_t v)
+		{
+			unsigned char b[4] = { static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8), static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24) };
+			bytes(b, 4);
+		}
+
+		void u16(std::uint16_t v)
+		{
+			unsigned char b[2] = { static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8) };
+			bytes(b, 2);
+		}
+
+		void f32(float v)
+		{
+			std::uint32_t u;
+			std::memcpy(&u, &v, 4);
+			u32(u);
+		}
+
+		void text(const std::string &s) { bytes(s.data(), s.size()); }
+
+		bool flush()
+		{
+			if (used > 0 && std::fwrite(block.data(), 1, used, file) != used) failed = true;
+			used = 0;
+			return !failed;
+		}
+
+	private:
+		std::FILE *file;
+		std::size_t used;
+		bool failed;
+		std::vector<char> block;
+	};
+
+	struct Index
+	{
+		std::vector<long long> first;//first global row of every vertex block, plus the total
+
+		explicit Index(const qrcode::MeshParts &parts)
+		{
+			first.push_back(0);
+			for (int i = 0; i < parts.verticles.size(); i++) first.push_back(first.back() + parts.verticles[i]->rows());
+		}
+
+		long long vertices() const { return first.back(); }
+
+		/*Row of the concatenated blocks*/
+		Eigen::Vector3f at(const qrcode::MeshParts &parts, long long row) const
+		{
+			int b = static_cast<int>(std::upper_bound(first.begin(), first.end(), row) - first.begin()) - 1;
+			return parts.verticles[b]->row(row - first[b]).transpose().cast<float>();
+		}
+	};
+
+	bool write_ply(std::FILE *file, const qrcode::MeshParts &parts, const Index &index, long long facets)
+	{
+		Stream out(file);
+		out.text("ply\nformat binary_little_endian 1.0\ncomment qrcode\n");
+		out.text("element vertex " + std::to_string(index.vertices()) + "\nproperty float x\nproperty float y\nproperty float z\n");
+		out.text("element face " + std::to_string(facets) + "\nproperty list uchar int vertex_indices\nend_header\n");
+
+		for (int b = 0; b < parts.verticles.size(); b++) {
+			const Eigen::MatrixXd &V = *parts.verticles[b];
+			for (int i = 0; i < V.rows(); i++)
+				for (int k = 0; k < 3; k++) out.f32(static_cast<float>(V(i, k)));
+		}
+
+		const unsigned char three = 3;
+		for (int b = 0; b < parts.facets.size(); b++) {
+			const Eigen::MatrixXi &F = *parts.facets[b];
+			for (int i = 0; i < F.rows(); i++) {
+				out.bytes(&three, 1);
+				for (int k = 0; k < 3; k++) out.u32(static_cast<std::uint32_t>(F(i, k)));
+			}
+		}
+		return out.flush();
+	}
+
+	bool write_stl(std::FILE *file, const qrcode::MeshParts &parts, const Index &index, long long facets)
+	{
+		Stream out(file);
+		char header[80] = "qrcode binary STL";
+		out.bytes(header, sizeof(header));
+		out.u32(static_cast<std::uint32_t>(facets));
+
+		for (int b = 0; b < parts.facets.size(); b++) {
+			const Eigen::MatrixXi &F = *parts.facets[b];
+			for (int i = 0; i < F.rows(); i++) {
+				Eigen::Vector3f a = index.at(parts, F(i, 0));
+				Eigen::Vector3f c = index.at(parts, F(i, 1));
+				Eigen::Vector3f d = index.at(parts, F(i, 2));
+				Eigen::Vector3f n = (c - a).cross(d - a);
+				float length = n.norm();
+				if (length > 0) n /= length;
+
+				for (int k = 0; k < 3; k++) out.f32(n(k));
+				for (int k = 0; k < 3; k++) out.f32(a(k));
+				for (int k = 0; k < 3; k++) out.f32(c(k));
+				for (int k = 0; k < 3; k++) out.f32(d(k));
+				out.u16(0);
+			}
+		}
+		return out.flush();
+	}
+}
+
+qrcode::MeshParts::MeshParts(const Eigen::MatrixXd & verticles, const Eigen::MatrixXi & facets)
+{
+	this->verticles.push_back(std::shared_ptr<const Eigen::MatrixXd>(&verticles, [](const Eigen::MatrixXd *) {}));
+	this->facets.push_back(std::shared_ptr<const Eigen::MatrixXi>(&facets, [](const Eigen::MatrixXi *) {}));
+}
+
+bool qrcode::write_mesh(const std::string & file, const MeshParts & parts)
+{
+	QR_TRACE_SCOPE("qrcode::write_mesh");
+	std::string extension = file.substr(file.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	const Index index(parts);
+	long long facets = 0;
+	for (int b = 0; b < parts.facets.size(); b++) facets += parts.facets[b]->rows();
+
+	if (extension != "ply" && extension != "stl") {
+		Eigen::MatrixXd V(index.vertices(), 3);
+		Eigen::MatrixXi F(facets, 3);
+		for (int b = 0; b < parts.verticles.size(); b++) V.middleRows(index.first[b], parts.verticles[b]->rows()) = *parts.verticles[b];
+		for (int b = 0, row = 0; b < parts.facets.size(); row += parts.facets[b]->rows(), b++) F.middleRows(row, parts.facets[b]->rows()) = *parts.facets[b];
+		return igl::writeOBJ(file, V, F);
+	}
+
+	std::FILE *out = std::fopen(file.c_str(), "wb");
+	if (!out) return false;
+
+	bool ok = extension == "ply" ? write_ply(out, parts, index, facets) : write_stl(out, parts, index, facets);
+	return std::fclose(out) == 0 && ok;
+}
+
+bool qrcode::write_mesh(const std::string & file, const Eigen::MatrixXd & verticles, const Eigen::MatrixXi & facets)
+{
+	return qrcode::write_mesh(file, MeshParts(verticles, facets));
+}
+
+std::future<bool> qrcode::write_mesh_async(const std::string & file, const MeshParts & parts)
+{
+	if (qrcode::num_threads() <= 1) {
+		std::promise<bool> done;
+		done.set_value(qrcode::write_mesh(file, parts));
+		return done.get_future();
+	}
+	return qrcode::async([file, parts]() { return qrcode::write_mesh(file, parts); });
+}
@@ -0,0 +1,54 @@
+// This project is about 3d QR code generating,see more details at https://github.com/swannyPeng/3dqrcode_libigl
+// 
+// Copyright (C) 2017 Swanny Peng <ph1994wh@gmail.com>
+// 
+// This Source Code Form is subject to the terms of the Mozilla Public License 
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can 
+// obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef WRITE_MESH_H_
+#define WRITE_MESH_H_
+#include <vector>
+#include <string>
+#include <memory>
+#include <future>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <Eigen/dense>
+#include <igl/writeOBJ.h>
+#include "task_scheduler.h"
+#include "trace.h"
+namespace qrcode {
+
+	/*
+	Vertex and facet blocks written as one mesh, e.g. the QR grid and the rest of the
+	model without merging them first: facets index the vertex blocks concatenated in
+	order. Blocks are shared, so an async write keeps them alive and the caller must
+	not change them afterwards.
+	*/
+	struct MeshParts
+	{
+		std::vector<std::shared_ptr<const Eigen::MatrixXd>> verticles;
+		std::vector<std::shared_ptr<const Eigen::MatrixXi>> facets;
+
+		MeshParts() {}
+		/*One block each, not owned: the matrices must outlive the write*/
+		MeshParts(const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets);
+	};
+
+	//************************************
+	// Method:    qrcode::write_mesh
+	//
+	// Little endian binary PLY (.ply) or binary STL (.stl), streamed from the Eigen
+	// buffers through a fixed block, with float coordinates and int indices. Any other
+	// extension goes to igl::writeOBJ on the merged parts.
+	//************************************
+	bool write_mesh(const std::string &file, const MeshParts &parts);
+	bool write_mesh(const std::string &file, const Eigen::MatrixXd &verticles, const Eigen::MatrixXi &facets);
+	/*Same on the task pool; inline when the pool has a single thread*/
+	std::future<bool> write_mesh_async(const std::string &file, const MeshParts &parts);
+}
+
+#endif // !WRITE_MESH_H_
@@ -14,8 +14,6 @@
 #include <igl/Timer.h>
 #include <igl/file_dialog_open.h>
 #include <igl/file_dialog_save.h>
-#include <igl/readOBJ.h>
-#include <igl/writeOBJ.h>
 #include <igl/png/writePNG.h>
 #include "global.h"
 #include "readQR.h"
@@ -29,6 +27,11 @@
 #include "fixhole.h"
 #include "directional_light.h"
 #include "reflaction.h"
+#include "trace.h"
+#include "task_scheduler.h"
+#include "memory_budget.h"
+#include "read_mesh.h"
+#include "write_mesh.h"
 /*global parameters */
 
 
@@ -65,7 +68,10 @@ int main(int argc, char *argv[])
 			file_name = igl::file_dialog_open();
 
 			if (file_name != "") {
-				if (igl::readOBJ(file_name, g.model_vertices, g.model_facets)) {
+				timer.start();
+				if (qrcode::read_mesh(file_name, g.model_vertices, g.model_facets)) {
+					std::cout << "Load mesh time: " << timer.getElapsedTimeInSec() << "s" << std::endl;
+					g.pipeline.touch("projection");
 
 					viewer.data.set_mesh(g.model_vertices, g.model_facets);
 
@@ -82,7 +88,7 @@ int main(int argc, char *argv[])
 			std::string file_name = "";
 			file_name= igl::file_dialog_save();
 			if (file_name != "") {
-				igl::writeOBJ(file_name, viewer.data.V, viewer.data.F);
+				qrcode::write_mesh(file_name, viewer.data.V, viewer.data.F);
 			}
 		});
 
@@ -92,6 +98,7 @@ int main(int argc, char *argv[])
 			if (file_name != "") {
 				timer.start();
 				g.info = qrcode::readQR(engine, file_name);
+				g.pipeline.touch("projection");
 				std::cout << "Version:" << static_cast<int>((g.info.pixels.size() - 17) / 4) << std::endl;
 				std::cout << "Load QR time: " << timer.getElapsedTimeInSec() << "s" << std::endl;
 
@@ -125,6 +132,7 @@ int main(int argc, char *argv[])
 			std::string str = igl::file_dialog_open();
 			viewer.load_scene(scene_file);
 			qrcode::deserialize(g, data_file);
+			g.pipeline.touch("projection");
 		});
 
 		viewer.ngui->addButton("Image onto mesh", [&]() {
@@ -132,7 +140,11 @@ int main(int argc, char *argv[])
 			g.mode = viewer.core.model;
 			g.zoom = viewer.core.model_zoom*viewer.core.camera_zoom;
 			
-			qrcode::image_onto_mesh(viewer, g);
+			if (!qrcode::memory_check(g, "Image onto mesh")) return;
+
+			if (!qrcode::image_onto_mesh(viewer, g)) return;
+			g.pipeline.touch("projection");
+			qrcode::release_intermediates(g, qrcode::MemoryStage::Projected);
 			qrcode::control_strategy(g);
 			qrcode::generate_qr_mesh(engine, g);
 			std::cout << "Image onto mesh time: " << timer.getElapsedTimeInSec() << "s" << std::endl;
@@ -188,6 +200,7 @@ int main(int argc, char *argv[])
 
 		viewer.ngui->addButton("Test make hole",[&]() {
 			qrcode::find_hole(engine, g);
+			qrcode::release_intermediates(g, qrcode::MemoryStage::HolesFound);
 			qrcode::make_hole(g);
 			qrcode::fix_hole(engine, g);
 
@@ -217,10 +230,26 @@ int main(int argc, char *argv[])
 		g.distance = 30;
 		viewer.ngui->addVariable("Distance", g.distance);
 
+		g.tiled_projection = false;
+		viewer.ngui->addVariable("Tiled projection", g.tiled_projection);
+
+		g.memory_limit = 0;
+		viewer.ngui->addVariable("Memory limit (MB)", g.memory_limit);
+
+		g.seed = 0;
+		viewer.ngui->addVariable("Seed", g.seed);
+
+		g.ao_benchmark = false;
+		viewer.ngui->addVariable("AO benchmark", g.ao_benchmark);
+
+		g.job.output_dir = "";
+		viewer.ngui->addVariable("Output folder", g.job.output_dir);
+
 
 		viewer.ngui->addButton("Direction light", [&]() {
 			Eigen::MatrixXd V;
 			Eigen::MatrixXi F;
+			if (!qrcode::memory_check(g, "Direction light")) return;
 			qrcode::directional_light(viewer, engine, g, V, F);
 
 			viewer.data.clear();
@@ -236,6 +265,24 @@ int main(int argc, char *argv[])
 		
 		});
 
+		viewer.ngui->addGroup("Profiling");
+		viewer.ngui->addVariable<bool>("Trace stages", [&](bool on) {
+			qrcode::trace::enable(on);
+		}, [&]()->bool {
+			return qrcode::trace::enabled();
+		});
+		viewer.ngui->addVariable<int>("Threads", [&](int n) {
+			qrcode::set_num_threads(n);
+		}, [&]()->int {
+			return qrcode::num_threads();
+		});
+		viewer.ngui->addButton("Export trace", [&]() {
+			if (qrcode::trace::export_chrome("trace.json"))
+				std::cout << qrcode::trace::summary();
+			else
+				std::cout << "Can not write trace.json" << std::endl;
+		});
+
 		viewer.screen->performLayout();
 		return false;
 	};